@@ -0,0 +1,127 @@
+/**
+ * @file bench/bench_engines.cpp
+ * @brief Benchmarks comparing the tree walker with the stack and register machines and closures.
+ **/
+
+#include "bench_framework.hpp"
+#include "closure.hpp"
+#include "interpreter.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+#include "regvm.hpp"
+#include "vm.hpp"
+#include <sstream>
+
+using namespace DemoLang;
+using namespace DemoLang::AST;
+using namespace DemoLang::ParserSpace;
+using namespace DemoLang::InterpreterSpace;
+using namespace DemoLang::OptimizerSpace;
+using namespace DemoLang::VMSpace;
+
+
+// Statements run per iteration, so reading the clock does not dominate
+static constexpr size_t repeats = 100;
+
+
+/**
+ * @brief Generate a long arithmetic statement over variables and literals.
+ * @param terms Number of terms.
+**/
+static std::string generateStatement(size_t terms) {
+    std::ostringstream statement;
+    statement << "result = ";
+    for (size_t i = 0; i < terms; i++) {
+        if (i > 0) statement << (i % 2 ? " + " : " - ");
+        statement << "(value_" << i % 16 << " * " << i % 7 + 2 << " + " << i << ".5) / (value_" << (i + 1) % 16 << " - " << i + 100 << ")";
+    }
+    return statement.str();
+}
+
+
+// Every engine reads the same variables
+static void defineVariables() {
+    for (size_t i = 0; i < 16; i++) {
+        auto definition = Parser::instance().parseSource("value_" + std::to_string(i) + " = " + std::to_string(i) + ".25");
+        Interpreter::instance().interpret(definition);
+        VM::instance().interpret(definition);
+        RegisterVM::instance().interpret(definition);
+        ClosureEngine::instance().interpret(definition);
+    }
+}
+
+
+class TreeBenchmark : public Benchmark {
+private:
+    std::shared_ptr<ASTNode> ast;
+
+public:
+    void setUp() override { ast = Optimizer::instance().optimize(Parser::instance().parseSource(generateStatement(50))); }
+    size_t run() override {
+        for (size_t i = 0; i < repeats; i++) Interpreter::instance().evaluate(*ast);
+        return repeats;
+    }
+};
+
+
+class StackBenchmark : public Benchmark {
+private:
+    Chunk chunk;
+
+public:
+    void setUp() override { chunk = Compiler().compile(*Optimizer::instance().optimize(Parser::instance().parseSource(generateStatement(50)))); }
+    size_t run() override {
+        for (size_t i = 0; i < repeats; i++) VM::instance().run(chunk);
+        return repeats;
+    }
+};
+
+
+class RegisterBenchmark : public Benchmark {
+private:
+    RegisterProgram program;
+
+public:
+    void setUp() override { program = RegisterCompiler().compile(*Optimizer::instance().optimize(Parser::instance().parseSource(generateStatement(50)))); }
+    size_t run() override {
+        for (size_t i = 0; i < repeats; i++) RegisterVM::instance().run(program);
+        return repeats;
+    }
+};
+
+
+class ClosureBenchmark : public Benchmark {
+private:
+    ClosureProgram program;
+
+public:
+    void setUp() override { program = ClosureCompiler().compile(*Optimizer::instance().optimize(Parser::instance().parseSource(generateStatement(50)))); }
+    size_t run() override {
+        for (size_t i = 0; i < repeats; i++) ClosureEngine::instance().run(program);
+        return repeats;
+    }
+};
+
+
+int main() {
+    defineVariables();
+    BenchRunner runner;
+    runner.addBenchmark("Engines: Tree walker", "statements", std::make_shared<TreeBenchmark>());
+    runner.addBenchmark("Engines: Stack VM", "statements", std::make_shared<StackBenchmark>());
+    runner.addBenchmark("Engines: Register VM", "statements", std::make_shared<RegisterBenchmark>());
+    runner.addBenchmark("Engines: Closures", "statements", std::make_shared<ClosureBenchmark>());
+    runner.runAll();
+
+    auto ast = Optimizer::instance().optimize(Parser::instance().parseSource(generateStatement(50)));
+    RegisterProgram program = RegisterCompiler().compile(*ast);
+    std::cout << "Instructions per statement: stack " << Compiler().compile(*ast).instructionCount()
+              << ", register " << program.size() << " (" << program.getRegisterCount() << " registers)" << std::endl;
+    for (const char* name : {"Engines: Tree walker", "Engines: Stack VM", "Engines: Register VM", "Engines: Closures"}) {
+        std::cout << name << ": " << 1e9 / runner.rate(name) << " ns/statement" << std::endl;
+    }
+    std::cout << "Register VM speedup over tree walker: "
+              << runner.rate("Engines: Register VM") / runner.rate("Engines: Tree walker") << "x" << std::endl;
+    std::cout << "Closures speedup over tree walker: "
+              << runner.rate("Engines: Closures") / runner.rate("Engines: Tree walker") << "x" << std::endl;
+    return 0;
+}
@@ -0,0 +1,73 @@
+/**
+ * @file bench/bench_framework.hpp
+ * @brief Benchmark framework for performance measurements.
+ **/
+
+#pragma once
+#ifndef BENCH_FRAMEWORK
+#define BENCH_FRAMEWORK
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <iostream>
+
+
+class Benchmark {
+public:
+    virtual ~Benchmark() = default;
+    virtual void setUp() {}
+    virtual void tearDown() {}
+    // Run one iteration and return the number of processed items
+    virtual size_t run() = 0;
+};
+
+class BenchRunner {
+private:
+    struct Entry {
+        std::string name;
+        std::string unit;
+        std::shared_ptr<Benchmark> bench;
+        double rate = 0.0;
+    };
+    std::vector<Entry> benches;
+    double minSeconds;
+
+public:
+    explicit BenchRunner(double minSeconds = 0.5) : minSeconds(minSeconds) {}
+
+    void addBenchmark(const std::string& name, const std::string& unit, std::shared_ptr<Benchmark> bench) {
+        benches.push_back({name, unit, bench});
+    }
+
+    void runAll() {
+        for (auto& entry : benches) {
+            entry.bench->setUp();
+            size_t items = 0, iterations = 0;
+            auto start = std::chrono::steady_clock::now();
+            double elapsed = 0.0;
+            // Repeat until the measurement is long enough to be stable
+            do {
+                items += entry.bench->run();
+                iterations++;
+                elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            } while (elapsed < minSeconds);
+            entry.bench->tearDown();
+
+            entry.rate = items / elapsed;
+            std::cout << "[BENCH] " << entry.name << ": " << static_cast<long long>(entry.rate)
+                      << " " << entry.unit << "/sec (" << iterations << " iterations)" << std::endl;
+        }
+    }
+
+    // Items per second measured for a benchmark, 0 if it has not run
+    double rate(const std::string& name) const {
+        for (const auto& entry : benches) {
+            if (entry.name == name) return entry.rate;
+        }
+        return 0.0;
+    }
+};
+
+#endif // BENCH_FRAMEWORK
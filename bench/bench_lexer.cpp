@@ -0,0 +1,119 @@
+/**
+ * @file bench/bench_lexer.cpp
+ * @brief Throughput benchmarks for the lexer module.
+ **/
+
+#include "bench_framework.hpp"
+#include "lexer.hpp"
+#include <sstream>
+#include <thread>
+
+using namespace DemoLang;
+using namespace DemoLang::Tokens;
+using namespace DemoLang::LexerSpace;
+
+
+/**
+ * @brief Generate a script resembling machine-generated input.
+ * @param lines Number of statements.
+**/
+static std::string generateScript(size_t lines) {
+    std::ostringstream script;
+    for (size_t i = 0; i < lines; i++) {
+        script << "var_" << i << " = (var_" << i / 2 << " + " << i << ".25) * " << i % 97
+               << " - \"literal number " << i << "\" != total_" << i % 13 << "\n";
+    }
+    return script.str();
+}
+
+
+/**
+ * @brief Generate a rule file dominated by long string literals and names.
+ * @param lines Number of statements.
+**/
+static std::string generateRules(size_t lines) {
+    std::ostringstream script;
+    for (size_t i = 0; i < lines; i++) {
+        script << "rule_description_for_entry_number_" << i << " = \"" << std::string(200, 'r')
+               << " " << i << "\" + " << 1234567890123LL + i << "\n";
+    }
+    return script.str();
+}
+
+
+class LexerBenchmark : public Benchmark {
+private:
+    LexerMode mode;
+    std::string script;
+
+public:
+    explicit LexerBenchmark(LexerMode mode) : mode(mode) {}
+    void setUp() override {
+        script = generateScript(2000);
+        Lexer::instance().setMode(mode);
+    }
+    size_t run() override {
+        return Lexer::instance().tokenize(script).size();
+    }
+};
+
+
+class KernelBenchmark : public Benchmark {
+private:
+    SimdLevel level;
+    std::string script;
+
+public:
+    explicit KernelBenchmark(SimdLevel level) : level(level) {}
+    void setUp() override {
+        script = generateRules(2000);
+        Lexer::instance().setMode(LexerMode::TABLE);
+        ScanKernels::select(level);
+    }
+    void tearDown() override {
+        ScanKernels::select(ScanKernels::detect());
+    }
+    size_t run() override {
+        Lexer::instance().scan(script);
+        return script.size();
+    }
+};
+
+
+class ParallelBenchmark : public Benchmark {
+private:
+    size_t threads;
+    std::string script;
+
+public:
+    explicit ParallelBenchmark(size_t threads) : threads(threads) {}
+    void setUp() override {
+        script = generateScript(200000);
+        Lexer::instance().setMode(LexerMode::TABLE);
+    }
+    size_t run() override {
+        return Lexer::instance().scanParallel(script, threads).size();
+    }
+};
+
+
+int main() {
+    BenchRunner runner;
+    runner.addBenchmark("Lexer: Chain", "tokens", std::make_shared<LexerBenchmark>(LexerMode::CHAIN));
+    runner.addBenchmark("Lexer: Table", "tokens", std::make_shared<LexerBenchmark>(LexerMode::TABLE));
+    runner.addBenchmark("Kernels: Scalar", "bytes", std::make_shared<KernelBenchmark>(SimdLevel::SCALAR));
+    runner.addBenchmark("Kernels: Detected", "bytes", std::make_shared<KernelBenchmark>(ScanKernels::detect()));
+    // Always 1, 2 and 4 threads, so scaling is comparable across machines
+    size_t cores = std::max<size_t>(4, std::thread::hardware_concurrency());
+    for (size_t threads = 1; threads <= cores; threads *= 2) {
+        runner.addBenchmark("Parallel: " + std::to_string(threads) + " threads", "tokens",
+                            std::make_shared<ParallelBenchmark>(threads));
+    }
+    runner.runAll();
+
+    std::cout << "Table speedup over chain: "
+              << runner.rate("Lexer: Table") / runner.rate("Lexer: Chain") << "x" << std::endl;
+    std::cout << "Detected kernels speedup over scalar: "
+              << runner.rate("Kernels: Detected") / runner.rate("Kernels: Scalar") << "x" << std::endl;
+    return 0;
+}
@@ -0,0 +1,59 @@
+/**
+ * @file bench/bench_parser.cpp
+ * @brief Throughput benchmarks for the parser module.
+ **/
+
+#include "bench_framework.hpp"
+#include "parser.hpp"
+#include <sstream>
+
+using namespace DemoLang;
+using namespace DemoLang::AST;
+using namespace DemoLang::ParserSpace;
+
+
+/**
+ * @brief Generate one long expression mixing every precedence level.
+ * @param terms Number of operands.
+**/
+static std::string generateExpression(size_t terms) {
+    std::ostringstream expression;
+    expression << "result = ";
+    for (size_t i = 0; i < terms; i++) {
+        if (i > 0) expression << (i % 3 == 0 ? " + " : i % 3 == 1 ? " * " : " - ");
+        expression << "(value_" << i % 64 << " < " << i << " | -" << i % 10 << ".5)";
+    }
+    return expression.str();
+}
+
+
+class ParseBenchmark : public Benchmark {
+private:
+    std::string source;
+    size_t terms;
+    bool cached;
+
+public:
+    ParseBenchmark(size_t terms, bool cached = false) : terms(terms), cached(cached) {}
+    void setUp() override {
+        source = generateExpression(terms);
+        Parser::instance().clearCache();
+    }
+
+    size_t run() override {
+        // Without the cache every iteration parses, and the tree is released at its end
+        if (!cached) Parser::instance().clearCache();
+        auto ast = Parser::instance().parseSource(source);
+        return ast ? terms : 0;
+    }
+};
+
+
+int main() {
+    BenchRunner runner;
+    runner.addBenchmark("Parser: Small expressions", "terms", std::make_shared<ParseBenchmark>(8));
+    runner.addBenchmark("Parser: Large expression", "terms", std::make_shared<ParseBenchmark>(20000));
+    runner.addBenchmark("Parser: Cached small expressions", "terms", std::make_shared<ParseBenchmark>(8, true));
+    runner.runAll();
+    return 0;
+}
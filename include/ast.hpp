@@ -26,6 +26,7 @@ public:
     
     virtual void visit(class UnaryOpNode& node) = 0;
     virtual void visit(class BinaryOpNode& node) = 0;
+    virtual void visit(class NaryOpNode& node) = 0;
     virtual void visit(class IdNode& node) = 0;
     virtual void visit(class IntNode& node) = 0;
     virtual void visit(class FloatNode& node) = 0;
@@ -43,6 +44,38 @@ struct ASTNode {
 };
 
 
+/**
+ * @brief Arena owning the nodes of one parsed tree.
+ * @note Children inside the arena are held by non-owning pointers, so building
+ *       and releasing a tree touches no reference counts.
+**/
+class ASTArena : public Utils::Arena {
+public:
+    using Utils::Arena::Arena;
+
+    /**
+     * @brief Pointer to a node without any ownership, the arena keeps it alive.
+    **/
+    static std::shared_ptr<ASTNode> borrow(ASTNode* node) {
+        return std::shared_ptr<ASTNode>(std::shared_ptr<ASTNode>(), node);
+    }
+
+    template <typename T, typename... Args>
+    std::shared_ptr<ASTNode> make(Args&&... args) {
+        return borrow(create<T>(std::forward<Args>(args)...));
+    }
+
+    /**
+     * @brief Take a node allocated elsewhere (e.g. a flyweight) into the tree.
+    **/
+    std::shared_ptr<ASTNode> adopt(std::shared_ptr<ASTNode> node) {
+        ASTNode* raw = node.get();
+        if (node.use_count() > 0) retain(std::move(node));
+        return borrow(raw);
+    }
+};
+
+
 /**
  * @brief Node representing unary operations.
 **/
@@ -80,17 +113,44 @@ public:
 };
 
 
+/**
+ * @brief Node representing a chain of one operator applied left to right, e.g. a + b + c.
+ * @note Evaluates like the left-deep tree of binary operations it replaces.
+**/
+class NaryOpNode : public ASTNode {
+private:
+    std::string op;
+    std::vector<std::shared_ptr<ASTNode>> operands;
+
+public:
+    NaryOpNode(std::string op, std::vector<std::shared_ptr<ASTNode>> operands)
+        : op(std::move(op)), operands(std::move(operands)) {}
+    void accept(ASTVisitor& visitor) override { visitor.visit(*this); }
+    const std::string& getOp() const { return op; }
+    size_t size() const { return operands.size(); }
+    ASTNode* getOperand(size_t index) const { return operands[index].get(); }
+    const std::vector<std::shared_ptr<ASTNode>>& getOperands() const { return operands; }
+
+    /**
+     * @brief Extend the chain while it is being built, before anything else refers to it.
+    **/
+    void append(std::shared_ptr<ASTNode> operand) { operands.push_back(std::move(operand)); }
+};
+
+
 /**
  * @brief Node representing identifiers.
 **/
 class IdNode : public ASTNode {
 private:
-    std::string name;
+    uint32_t symbol;
 
 public:
-    IdNode(const std::string& id) : name(id) {}
+    IdNode(uint32_t symbol) : symbol(symbol) {}
+    IdNode(const std::string& id) : symbol(Utils::SymbolTable::instance().intern(id)) {}
     void accept(ASTVisitor& visitor) override { visitor.visit(*this); }
-    const std::string& getName() const { return name; }
+    uint32_t getSymbol() const { return symbol; }
+    const std::string& getName() const { return Utils::SymbolTable::instance().name(symbol); }
 };
 
 
@@ -149,6 +209,31 @@ public:
     const std::string& getMessage() const { return message; }
 };
 
+/**
+ * @brief A statement of a program and the line it starts on.
+**/
+struct Statement {
+    std::shared_ptr<ASTNode> node;
+    size_t line;
+};
+
+
+/**
+ * @brief A parsed script, its statements in source order.
+**/
+class Program {
+private:
+    std::vector<Statement> statements;
+
+public:
+    void add(std::shared_ptr<ASTNode> node, size_t line) { statements.push_back({std::move(node), line}); }
+    size_t size() const { return statements.size(); }
+    bool empty() const { return statements.empty(); }
+    const Statement& operator[](size_t index) const { return statements[index]; }
+    std::vector<Statement>::const_iterator begin() const { return statements.begin(); }
+    std::vector<Statement>::const_iterator end() const { return statements.end(); }
+};
+
 } // namespace AST
 
 } // namespace DemoLang
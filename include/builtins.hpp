@@ -7,94 +7,142 @@
 #ifndef DEMOLANG_BUILTINS
 #define DEMOLANG_BUILTINS
 
-#include <any>
-#include <iostream>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
 
 
 namespace DemoLang {
 
 namespace ValueTypes {
 
-class BaseType {
-private:
-    std::string name;
-    std::any value;
-
+/**
+ * @brief Runtime value, a tagged union with numbers stored inline.
+ * @note Integers and Floats never touch the heap. Strings and exception
+ *       messages live in an immutable, reference counted payload, so copying
+ *       a value never copies text. The count is not atomic, values belong to
+ *       the thread of the interpreter that made them.
+ *       The union is as wide as a long double, so a value takes two of them:
+ *       32 bytes where long double is extended precision, 16 where it is a double.
+**/
+class Value {
 public:
-    BaseType() = default;
-    virtual bool operator==(const BaseType& other) const {
-        return this->getName() == other.getName() &&
-            std::any_cast<std::string>(this->getValue()) == std::any_cast<std::string>(other.getValue());
-    }
-    virtual bool operator!=(const BaseType& other) const {
-        return this->getName() != other.getName() ||
-            std::any_cast<std::string>(this->getValue()) != std::any_cast<std::string>(other.getValue());
-    }
-    virtual std::string getName() const = 0;
-    virtual std::any getValue() const = 0;
-    virtual std::shared_ptr<BaseType> clone() const = 0;
-};
+    enum class Type : uint8_t {
+        NONE,           // No value, e.g. an unset variable
+        INTEGER,
+        FLOAT,
+        STRING,
+        EXCEPTION       // An error, carrying its message
+    };
+    static constexpr size_t typeCount = 5;
 
-
-class Integer : public BaseType {
 private:
-    std::string name = "Integer";
-    long long value;
-
-public:
-    Integer() = default;
-    explicit Integer(long long val) : value(val) {}
-    std::string getName() const override { return name; }
-    std::any getValue() const override { return value; }
-    std::shared_ptr<BaseType> clone() const override {
-        return std::make_shared<Integer>(value);
+    struct Text {
+        size_t refs;
+        std::string value;
+    };
+
+    union {
+        long long integer;
+        long double real;
+        Text* text;
+    };
+    Type type = Type::NONE;
+
+    bool hasText() const { return type == Type::STRING || type == Type::EXCEPTION; }
+
+    void copyFrom(const Value& other) {
+        type = other.type;
+        switch (type) {
+            case Type::FLOAT:   real = other.real; break;
+            case Type::STRING:
+            case Type::EXCEPTION:
+                text = other.text;
+                text->refs++;
+                break;
+            default:            integer = other.integer; break;
+        }
     }
-};
-
-
-class Float : public BaseType {
-private:
-    std::string name = "Float";
-    long double value;
 
-public:
-    Float() = default;
-    explicit Float(long double val) : value(val) {}
-    std::string getName() const override { return name; }
-    std::any getValue() const override { return value; }
-    std::shared_ptr<BaseType> clone() const override {
-        return std::make_shared<Float>(value);
+    void moveFrom(Value& other) {
+        type = other.type;
+        if (type == Type::FLOAT) real = other.real;
+        else if (hasText()) text = other.text;
+        else integer = other.integer;
+        other.type = Type::NONE;
     }
-};
 
+    void release() {
+        if (hasText() && --text->refs == 0) delete text;
+        type = Type::NONE;
+    }
 
-class String : public BaseType {
-private:
-    std::string name = "String";
-    std::string value;
+    static Value withText(Type type, std::string value) {
+        Value result;
+        result.text = new Text{1, std::move(value)};
+        result.type = type;
+        return result;
+    }
 
 public:
-    String() = default;
-    explicit String(const std::string& val) : value(val) {}
-    std::string getName() const override { return name; }
-    std::any getValue() const override { return value; }
-    std::shared_ptr<BaseType> clone() const override {
-        return std::make_shared<String>(value);
+    Value() : integer(0) {}
+    Value(const Value& other) : integer(0) { copyFrom(other); }
+    Value(Value&& other) noexcept : integer(0) { moveFrom(other); }
+    Value& operator=(const Value& other) {
+        if (this != &other) {
+            release();
+            copyFrom(other);
+        }
+        return *this;
     }
-};
-
-class Exception : public BaseType {
-private:
-    std::string name = "Exception";
-    std::string value;
+    Value& operator=(Value&& other) noexcept {
+        if (this != &other) {
+            release();
+            moveFrom(other);
+        }
+        return *this;
+    }
+    ~Value() { release(); }
 
-public:
-    Exception() = default;
-    explicit Exception(const std::string& val) : value(val) {}
-    std::string getName() const override { return name; }
-    std::any getValue() const override { return value; }
-    std::shared_ptr<BaseType> clone() const override {
-        return std::make_shared<Exception>(value);
+    static Value makeInteger(long long value) {
+        Value result;
+        result.integer = value;
+        result.type = Type::INTEGER;
+        return result;
+    }
+    static Value makeFloat(long double value) {
+        Value result;
+        result.real = value;
+        result.type = Type::FLOAT;
+        return result;
+    }
+    static Value makeString(std::string value) { return withText(Type::STRING, std::move(value)); }
+    static Value makeException(std::string message) { return withText(Type::EXCEPTION, std::move(message)); }
+
+    Type getType() const { return type; }
+    bool isNone() const { return type == Type::NONE; }
+    bool isInteger() const { return type == Type::INTEGER; }
+    bool isFloat() const { return type == Type::FLOAT; }
+    bool isString() const { return type == Type::STRING; }
+    bool isException() const { return type == Type::EXCEPTION; }
+    bool isNumeric() const { return type == Type::INTEGER || type == Type::FLOAT; }
+
+    long long getInteger() const { return integer; }
+    long double getFloat() const { return real; }
+    // Text of a String, message of an Exception
+    const std::string& getString() const { return text->value; }
+    // Float value of a numeric value, as Integers are promoted when mixed with Floats
+    long double toFloat() const { return type == Type::INTEGER ? static_cast<long double>(integer) : real; }
+
+    const char* getName() const {
+        switch (type) {
+            case Type::INTEGER:     return "Integer";
+            case Type::FLOAT:       return "Float";
+            case Type::STRING:      return "String";
+            case Type::EXCEPTION:   return "Exception";
+            default:                return "None";
+        }
     }
 };
 
@@ -102,4 +150,4 @@ public:
 
 } // namespace DemoLang
 
-#endif // DEMOLANG_BUILTINS
\ No newline at end of file
+#endif // DEMOLANG_BUILTINS
@@ -0,0 +1,167 @@
+/**
+ * @file include/closure.hpp
+ * @brief Compile an Abstract Syntax Tree (AST) once into a tree of pre-bound closures.
+**/
+
+#pragma once
+#ifndef DEMOLANG_CLOSURE
+#define DEMOLANG_CLOSURE
+
+#include "vm.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace DemoLang {
+
+namespace VMSpace {
+
+/**
+ * @brief One node of a compiled statement.
+ * @note call is chosen at compile time for the node's operator and the kind
+ *       of its operands, so running a node is one direct call through a
+ *       function pointer, with no visitor and no operator text.
+**/
+struct Closure {
+    /**
+     * @brief State of the engine running the program, handed down every call.
+    **/
+    struct Context {
+        Environment& env;
+        std::vector<Value>& pending;    // Operands of the chains being computed
+    };
+
+    using Call = Value (*)(const Closure& self, Context& context);
+
+    enum class Kind : uint8_t {
+        CONSTANT,           // A literal or a known result
+        VARIABLE,
+        ASSIGN,             // Assign operand 0 to the symbol
+        INVALID_ASSIGN,     // Compute both operands, then give the constant
+        UNARY,
+        BINARY,
+        CHAIN               // Apply the operator to count operands at once, as executeChain
+    };
+
+    Call call = nullptr;
+    Kind kind = Kind::CONSTANT;
+    Operator op = Operator::NONE;
+    uint32_t symbol = 0;
+    uint32_t count = 0;                         // Number of operands
+    const Closure* const* operands = nullptr;   // In evaluation order
+    Value constant;
+
+    Value operator()(Context& context) const { return call(*this, context); }
+};
+
+
+/**
+ * @brief Closures of one statement, owning every node.
+ * @note Nodes are stored in post-order in one array and point at each
+ *       other, so a program can be moved but not copied.
+**/
+class ClosureProgram {
+    friend class ClosureCompiler;
+
+private:
+    std::vector<Closure> closures;
+    std::vector<const Closure*> links;          // Operands of every node
+    size_t depth = 0;                           // Depth of the deepest node, the root is at 1
+    size_t maxDepth = Interpreter::defaultMaxDepth;
+
+public:
+    ClosureProgram() = default;
+    ClosureProgram(const ClosureProgram&) = delete;
+    ClosureProgram& operator=(const ClosureProgram&) = delete;
+    ClosureProgram(ClosureProgram&&) = default;
+    ClosureProgram& operator=(ClosureProgram&&) = default;
+
+    bool empty() const { return closures.empty(); }
+    size_t size() const { return closures.size(); }
+    size_t getDepth() const { return depth; }
+    size_t getMaxDepth() const { return maxDepth; }
+    const Closure& root() const { return closures.back(); }
+};
+
+
+/**
+ * @brief Compiler from pointer trees to closures.
+ * @note Operators, literal values and variable symbols are all resolved
+ *       here, the tree is not needed once the program is built.
+**/
+class ClosureCompiler : public TreeCompiler {
+private:
+    ClosureProgram program;
+    std::vector<uint32_t> built;                // Closures of the nodes compiled so far
+    std::vector<uint32_t> firsts;               // First link of every closure
+    std::vector<uint32_t> targets;              // Closure each link points at
+
+    void add(Closure closure, size_t operands);
+    void constant(Value value);
+
+public:
+    ClosureCompiler() = default;
+
+    /**
+     * @brief Compile a tree, the program returns the value Interpreter::evaluate gives.
+    **/
+    ClosureProgram compile(ASTNode& root);
+
+    void visit(UnaryOpNode& node) override;
+    void visit(BinaryOpNode& node) override;
+    void visit(NaryOpNode& node) override;
+    void visit(IdNode& node) override;
+    void visit(IntNode& node) override;
+    void visit(FloatNode& node) override;
+    void visit(StringNode& node) override;
+    void visit(ErrorNode& node) override;
+};
+
+
+/**
+ * @brief Runs closure programs.
+ * @note A program runs by calling its root, which calls its operands in
+ *       turn. Programs deeper than the recursion limit, or than their
+ *       maximum depth, run the same closures from an explicit work stack
+ *       instead, so the C++ stack stays bounded. Variables live in the
+ *       engine's own environment.
+**/
+class ClosureEngine : public Singleton<ClosureEngine> {
+    friend class Singleton<ClosureEngine>;
+
+private:
+    struct Task {
+        const Closure* closure;
+        uint32_t depth;
+        bool combine;
+    };
+
+    Environment env = Environment();
+    std::vector<Value> pending;     // Operands of the chains being called, a nested chain stacks its own above them
+    std::vector<Task> tasks;
+    std::vector<Value> values;
+
+    Value walk(const ClosureProgram& program);
+
+public:
+    static constexpr size_t recursionLimit = 4096;
+
+    ClosureEngine() = default;
+
+    Value run(const ClosureProgram& program);
+    std::string interpret(const ClosureProgram& program);
+
+    /**
+     * @brief Compile a tree and run it.
+     * @return The same text Interpreter::interpret gives for the tree.
+    **/
+    std::string interpret(const std::shared_ptr<ASTNode>& node);
+};
+
+} // namespace VMSpace
+
+} // namespace DemoLang
+
+#endif // DEMOLANG_CLOSURE
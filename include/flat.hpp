@@ -0,0 +1,210 @@
+/**
+ * @file include/flat.hpp
+ * @brief Flat, index-based encoding of the Abstract Syntax Tree (AST).
+**/
+
+#pragma once
+#ifndef DEMOLANG_FLAT
+#define DEMOLANG_FLAT
+
+#include "ast.hpp"
+#include "tokens.hpp"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace DemoLang;
+using namespace DemoLang::Tokens;
+
+
+namespace DemoLang {
+
+namespace AST {
+
+/**
+ * @brief One-byte operation of a flat node.
+**/
+enum class OpCode : uint8_t {
+    INT,                // a: index in the integer pool
+    FLOAT,              // a: index in the float pool
+    STRING,             // a: index in the string pool
+    LOAD,               // a: symbol id of the variable, b: assignments to it before
+    ERROR,              // a: index of the message in the string pool
+    NEG, NOT,           // a: operand
+    ADD, SUB, MUL, DIV,
+    EQ, NE, LT, LE, GT, GE,
+    AND, OR,            // a: left operand, b: right operand
+    ASSIGN,             // a: symbol id of the target, b: value
+    INVALID_UNARY,      // a: operand, the operator is not a unary one
+    INVALID_BINARY,     // a, b: operands, the operator is not a binary one
+    INVALID_ASSIGN,     // a, b: operands, the target is not an identifier
+    SUM, PRODUCT        // a: first operand in the operand pool, b: operand count
+};
+
+
+/**
+ * @brief Type a node's value is known to have before it is evaluated.
+ * @note DYNAMIC covers every value, including exceptions, so only nodes whose
+ *       value can never be anything but the given type are annotated.
+**/
+enum class StaticType : uint8_t {
+    DYNAMIC,
+    INTEGER,
+    FLOAT,
+    STRING
+};
+
+constexpr bool isNumeric(StaticType type) {
+    return type == StaticType::INTEGER || type == StaticType::FLOAT;
+}
+
+
+/**
+ * @brief Node of a flat tree, its children are indices of earlier nodes.
+**/
+struct FlatNode {
+    OpCode op;
+    uint32_t a;
+    uint32_t b;
+};
+
+
+/**
+ * @brief Operator of each unary and binary opcode, Operator::NONE for the others.
+**/
+constexpr Operator toOperator(OpCode op) {
+    switch (op) {
+        case OpCode::NEG:       return Operator::MINUS;
+        case OpCode::NOT:       return Operator::NOT;
+        case OpCode::ADD:       return Operator::PLUS;
+        case OpCode::SUB:       return Operator::MINUS;
+        case OpCode::MUL:       return Operator::MULTIPLY;
+        case OpCode::DIV:       return Operator::DIVIDE;
+        case OpCode::EQ:        return Operator::EQUAL;
+        case OpCode::NE:        return Operator::NOT_EQUAL;
+        case OpCode::LT:        return Operator::LESS;
+        case OpCode::LE:        return Operator::LESS_EQUAL;
+        case OpCode::GT:        return Operator::GREATER;
+        case OpCode::GE:        return Operator::GREATER_EQUAL;
+        case OpCode::AND:       return Operator::AND;
+        case OpCode::OR:        return Operator::OR;
+        case OpCode::ASSIGN:    return Operator::ASSIGN;
+        case OpCode::SUM:       return Operator::PLUS;
+        case OpCode::PRODUCT:   return Operator::MULTIPLY;
+        default:                return Operator::NONE;
+    }
+}
+
+
+/**
+ * @brief Contiguous encoding of one or more statements, in post-order.
+ * @note Evaluating the nodes front to back visits every operand before its
+ *       operator, in the same order as the pointer tree's visitor does.
+ *       Pure subexpressions are hash-consed into a single node, which makes
+ *       the encoding a DAG whose shared nodes are evaluated once. A variable
+ *       read is keyed by how many assignments to it came before, so a
+ *       subexpression is only shared while the variables it reads are
+ *       unchanged.
+**/
+class FlatAST {
+private:
+    struct Consing;
+
+    std::vector<FlatNode> nodes;
+    std::vector<uint32_t> roots;        // Root of every statement, in order
+    std::vector<uint32_t> ends;         // One past the last node each statement added
+    std::vector<long long> integers;
+    std::vector<long double> floats;
+    std::vector<std::string> strings;   // String literals and error messages
+    std::vector<uint32_t> chains;       // Operands of n-ary nodes, each list contiguous
+    std::vector<StaticType> types;      // Inferred type of every node
+    std::unique_ptr<Consing> consing;
+    size_t maxDepth = defaultMaxDepth;
+
+    // Appends a node with the type its opcode gives its operands' types
+    uint32_t push(const FlatNode& node);
+    StaticType infer(const FlatNode& node) const;
+
+public:
+    // Same limit as Interpreter::defaultMaxDepth
+    static constexpr size_t defaultMaxDepth = 1000000;
+
+    FlatAST();
+    explicit FlatAST(ASTNode& root, size_t maxDepth = defaultMaxDepth);
+    FlatAST(FlatAST&& other) noexcept;
+    FlatAST& operator=(FlatAST&& other) noexcept;
+    ~FlatAST();
+
+    /**
+     * @brief Encode a statement after the ones already in the tree.
+     * @return Index of the statement's root node.
+     * @note A statement deeper than the maximum depth keeps the nodes built
+     *       before its first node that is too deep, and its root evaluates to
+     *       the Exception Interpreter::evaluate gives for the pointer tree.
+    **/
+    uint32_t append(ASTNode& root);
+
+    // Same limit as Interpreter::setMaxDepth, for the statements appended from now on
+    void setMaxDepth(size_t depth) { maxDepth = depth; }
+    size_t getMaxDepth() const { return maxDepth; }
+
+    const std::vector<FlatNode>& getNodes() const { return nodes; }
+    const std::vector<uint32_t>& getRoots() const { return roots; }
+    size_t statementCount() const { return roots.size(); }
+
+    /**
+     * @brief Nodes a statement adds, evaluating them in order also evaluates its root.
+    **/
+    uint32_t statementBegin(size_t statement) const { return statement == 0 ? 0 : ends[statement - 1]; }
+    uint32_t statementEnd(size_t statement) const { return ends[statement]; }
+    size_t size() const { return nodes.size(); }
+    bool empty() const { return nodes.empty(); }
+    uint32_t root() const { return roots.back(); }
+
+    long long integer(uint32_t index) const { return integers[index]; }
+    long double floating(uint32_t index) const { return floats[index]; }
+    const std::string& string(uint32_t index) const { return strings[index]; }
+    const uint32_t* operands(const FlatNode& node) const { return chains.data() + node.a; }
+
+    /**
+     * @brief Type of a node, inferred from literals and the operator semantics.
+     * @note A variable read has the type of the value last assigned to it in
+     *       this tree, reads before any assignment in the tree are DYNAMIC.
+    **/
+    StaticType type(uint32_t index) const { return types[index]; }
+    const std::vector<StaticType>& getTypes() const { return types; }
+
+    /**
+     * @brief Get the node for an operation, reusing an identical pure one.
+    **/
+    uint32_t node(OpCode op, uint32_t a = 0, uint32_t b = 0);
+    uint32_t load(uint32_t symbol);
+    uint32_t assign(uint32_t symbol, uint32_t value);
+    uint32_t chain(OpCode op, const std::vector<uint32_t>& operands);
+    uint32_t addInteger(long long value);
+    uint32_t addFloat(long double value);
+    uint32_t addString(const std::string& value);
+
+    /**
+     * @brief Rebuild the pointer tree of a statement, the last one by default.
+     * @note Shared nodes become shared children, for debugging and for passes
+     *       written against pointer trees.
+    **/
+    std::shared_ptr<ASTNode> toTree() const { return toTree(roots.size() - 1); }
+    std::shared_ptr<ASTNode> toTree(size_t statement) const;
+
+    /**
+     * @brief One line per node, e.g. "3: ADD 1 2".
+    **/
+    std::string dump() const;
+
+    static const char* name(OpCode op);
+};
+
+} // namespace AST
+
+} // namespace DemoLang
+
+#endif // DEMOLANG_FLAT
@@ -9,8 +9,12 @@
 
 #include "ast.hpp"
 #include "builtins.hpp"
+#include "flat.hpp"
+#include "tokens.hpp"
 #include "utils.hpp"
+#include <array>
 #include <unordered_map>
+#include <vector>
 #include <functional>
 
 using namespace DemoLang;
@@ -28,14 +32,54 @@ namespace InterpreterSpace {
 **/
 class Environment {
 private:
-    std::unordered_map<std::string, std::shared_ptr<BaseType>> scope;
+    // Indexed by symbol id, an empty slot is an undefined variable
+    std::vector<Value> scope;
 
 public:
     Environment() = default;
     
-    bool has(const std::string& name) const;
-    std::shared_ptr<BaseType> get(const std::string& name) const;
-    void set(const std::string& name, const BaseType& value);
+    bool has(uint32_t symbol) const;
+    Value get(uint32_t symbol) const;
+    void set(uint32_t symbol, const Value& value);
+};
+
+
+/**
+ * @brief Binary operator semantics, looked up by operator id and operand types
+**/
+class BinOperatorFactory {
+public:
+    using Kernel = Value (*)(const Value& left, const Value& right);
+
+    /**
+     * @brief Kernel of an operator for operands of the given types.
+     * @note The table is filled at compile time with one kernel per operator
+     *       and pair of types, whose type checks are all resolved statically.
+     *       A pair an operator rejects gets a kernel returning its error.
+    **/
+    static Kernel kernel(Operator op, Value::Type left, Value::Type right);
+    static Value execute(Operator op, const Value& left, const Value& right) {
+        return kernel(op, left.getType(), right.getType())(left, right);
+    }
+
+    /**
+     * @brief Apply an operator to a chain of operands from left to right.
+     * @return The same value as applying execute() pairwise, sums and products
+     *         are accumulated in one loop and strings joined into one allocation.
+    **/
+    static Value executeChain(Operator op, const Value* operands, size_t count);
+    static Value executeChain(Operator op, const std::vector<Value>& operands) {
+        return executeChain(op, operands.data(), operands.size());
+    }
+};
+
+
+/**
+ * @brief Unary operator semantics, looked up by operator id
+**/
+class UnaryOperatorFactory {
+public:
+    static Value execute(Operator op, const Value& operand);
 };
 
 
@@ -46,15 +90,65 @@ class Interpreter : public Singleton<Interpreter>, public ASTVisitor {
     friend class Singleton<Interpreter>;
 
 private:
+    // A node to visit, first to schedule its operands and then to combine them
+    struct Task {
+        ASTNode* node;
+        uint32_t depth;
+        bool combine;
+    };
+
     Environment env = Environment();
-    std::shared_ptr<BaseType> result;
+    Value result;
+    std::vector<Value> values;                      // Value of every flat node
+    std::vector<Task> tasks;                        // Pending work of a pointer tree
+    std::vector<Value> operands;
+    std::vector<Value> chain;                       // Operands of an n-ary node
+    Task task{};                                    // Task being visited
+    size_t maxDepth = defaultMaxDepth;
+
+    void run(const FlatAST& tree, uint32_t begin, uint32_t end);
+    // Evaluates a numeric node without checking operand tags, false if it needs the generic path
+    bool compute(const FlatAST& tree, uint32_t index);
+    Value pop();
 
 public:
+    static constexpr size_t defaultMaxDepth = 1000000;
+
     Interpreter() = default;
     std::string interpret(const std::shared_ptr<ASTNode>& node);
+
+    // Text printed for a result, shared by every engine
+    static std::string render(const Value& value);
+
+    /**
+     * @brief Evaluate a pointer tree with an explicit work stack.
+     * @note The C++ stack does not grow with the tree, a tree deeper than the
+     *       maximum depth evaluates to an Exception.
+    **/
+    Value evaluate(ASTNode& root);
+    void setMaxDepth(size_t depth) { maxDepth = depth; }
+    size_t getMaxDepth() const { return maxDepth; }
+
+    /**
+     * @brief Evaluate a flat tree with a single front-to-back pass over its nodes.
+     * @return The same text interpret() gives for the last statement's pointer tree.
+     * @note Nodes the tree types as Integer or Float are computed straight
+     *       from their operands' numbers, without the factories' tag checks.
+    **/
+    std::string interpret(const FlatAST& tree);
+    Value evaluate(const FlatAST& tree);
+
+    /**
+     * @brief Evaluate one statement of a flat tree.
+     * @note Statements must be evaluated in order from the first, later ones
+     *       reuse the values of shared nodes computed by earlier ones.
+    **/
+    Value evaluate(const FlatAST& tree, size_t statement);
+    std::string interpret(const FlatAST& tree, size_t statement);
     
     void visit(UnaryOpNode& node) override;
     void visit(BinaryOpNode& node) override;
+    void visit(NaryOpNode& node) override;
     void visit(IdNode& node) override;
     void visit(IntNode& node) override;
     void visit(FloatNode& node) override;
@@ -9,6 +9,11 @@
 
 #include "tokens.hpp"
 #include "utils.hpp"
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <string_view>
 #include <vector>
 #include <memory>
 
@@ -21,6 +26,15 @@ namespace DemoLang {
 
 namespace LexerSpace {
 
+/**
+ * @brief Strategies the lexer can use to recognize tokens.
+**/
+enum class LexerMode {
+    CHAIN,  // Chain of responsibility built for every token
+    TABLE   // Character-class table driving a single-pass DFA
+};
+
+
 /**
  * @brief Lexer class for tokenizing input.
 **/
@@ -30,16 +44,207 @@ class Lexer : public Singleton<Lexer> {
 private:
     std::string input;
     size_t position;
+    LexerMode mode;
+
+    std::vector<Token> tokenizeChain();
 
 public:
-    Lexer() : position(0) {};
+    Lexer() : position(0), mode(LexerMode::TABLE) {};
     
-    std::string getInput() const { return input; };
+    LexerMode getMode() const { return mode; };
+    void setMode(LexerMode mode) { this->mode = mode; };
+
+    const std::string& getInput() const { return input; };
     size_t pos() const { return position; };
     char current() const { return position >= input.length() ? '\0' : input[position]; };
     void advance(size_t step=1) { position += step; };
     Token nextToken();
     std::vector<Token> tokenize(const std::string &input);
+    TokenStream scan(std::string source);
+
+    /**
+     * @brief Scan a large source on several threads, split at newlines.
+     * @param source The source to scan.
+     * @param threads Number of worker threads, 0 for one per hardware thread.
+     * @param minChunk Smallest number of bytes worth giving to a worker.
+     * @return Exactly the stream scan() would produce.
+     * @note Like scan(), throws std::length_error for a source of 4 GiB or more.
+    **/
+    TokenStream scanParallel(std::string source, size_t threads = 0, size_t minChunk = 1 << 16);
+
+    /**
+     * @brief Lazily produce the tokens of a source, one per pull.
+     * @param source The source to scan, it must outlive the generator.
+     * @return Generator yielding the same tokens as scan(), ending with END.
+     * @note A yielded view is only valid until the next pull.
+    **/
+    Generator<TokenView> tokens(std::string_view source);
+};
+
+
+/**
+ * @brief Character classes of the table-driven scanner.
+**/
+enum class CharClass : uint8_t {
+    END,            // NUL, treated as end of input
+    WHITESPACE,     // Skippable whitespace
+    QUOTE,          // String delimiters
+    DIGIT,          // Decimal digits
+    OPERATOR,       // First character of an operator
+    IDENTIFIER,     // Letters and underscore
+    UNKNOWN         // Anything else
+};
+
+
+/**
+ * @brief Errors reported by the table-driven scanner.
+**/
+enum class LexError : uint8_t {
+    NONE,
+    INVALID_FLOAT,              // "Invalid float: <text>"
+    MULTIPLE_DECIMAL_POINTS,    // "Multiple decimal points"
+    UNTERMINATED_STRING,        // "Unterminated string: <text>"
+    UNKNOWN_CHARACTER           // "Unknown character: <char>"
+};
+
+
+/**
+ * @brief A lexeme located in the scanned input.
+**/
+struct Lexeme {
+    TokenType type;
+    LexError error;
+    size_t begin;   // Offset of the first character
+    size_t end;     // Offset one past the last character
+};
+
+
+/**
+ * @brief Instruction set levels available to the scanning kernels.
+**/
+enum class SimdLevel : uint8_t {
+    SCALAR,     // Portable byte-at-a-time loops
+    SSE2,       // 16 bytes per step
+    AVX2        // 32 bytes per step
+};
+
+
+/**
+ * @brief Kernels finding the end of a character run.
+ * @note Each kernel returns the first position at or after pos that does not
+ *       belong to the run, or pos itself when pos is past the input.
+**/
+struct ScanKernels {
+    SimdLevel level;
+    size_t (*identifier)(std::string_view input, size_t pos);       // [A-Za-z0-9_]
+    size_t (*digits)(std::string_view input, size_t pos);           // [0-9]
+    size_t (*string)(std::string_view input, size_t pos, char quote); // Stops at quote, backslash or NUL
+
+    static SimdLevel detect();
+    static const ScanKernels& forLevel(SimdLevel level);
+    static const ScanKernels& active();
+    static void select(SimdLevel level);
+};
+
+
+/**
+ * @brief Single-pass scanner driven by a 256-entry character-class table.
+ * @note Reproduces the chain of handlers exactly, including the fact that only
+ *       one whitespace character is skipped before a token is recognized.
+**/
+class TableScanner {
+private:
+    std::string_view input;
+    size_t position;
+    const ScanKernels& kernels;
+
+    char at(size_t pos) const { return pos < input.size() ? input[pos] : '\0'; };
+    Lexeme scanString(size_t begin);
+    Lexeme scanNumber(size_t begin);
+    Lexeme scanOperator(size_t begin);
+    Lexeme scanIdentifier(size_t begin);
+
+public:
+    explicit TableScanner(std::string_view input, size_t position = 0)
+        : input(input), position(position), kernels(ScanKernels::active()) {};
+
+    static const std::array<CharClass, 256>& classes();
+    static CharClass classOf(char c) { return classes()[static_cast<unsigned char>(c)]; };
+
+    size_t pos() const { return position; };
+    Lexeme next();
+    std::string text(const Lexeme& lexeme) const;
+    Token token(const Lexeme& lexeme) const;
+    std::vector<Token> tokenize();
+    void scan(TokenStream& stream);
+};
+
+
+/**
+ * @brief Lexer pulling its input in fixed-size chunks from a stream or file descriptor.
+ * @note A token that may continue past the end of the buffered input is scanned
+ *       again once the next chunk arrives, so only the unfinished token is carried
+ *       over and memory stays bounded by the chunk size plus the longest token.
+ *       A reader reports a failed read by throwing, which ends the tokens with
+ *       an ERROR carrying its message instead of a truncated source.
+**/
+class StreamLexer {
+private:
+    std::function<size_t(char*, size_t)> reader;
+    std::string buffer;
+    std::string message;
+    size_t position;
+    size_t chunkSize;
+    bool exhausted;
+    bool finished;
+    bool failed;
+
+    bool refill();
+
+public:
+    static constexpr size_t defaultChunkSize = 64 * 1024;
+
+    explicit StreamLexer(std::istream& in, size_t chunkSize = defaultChunkSize);
+    explicit StreamLexer(int fd, size_t chunkSize = defaultChunkSize);
+    StreamLexer(std::function<size_t(char*, size_t)> reader, size_t chunkSize);
+
+    /**
+     * @brief Scan the next token.
+     * @return The token, whose value stays valid until the next call.
+    **/
+    TokenView next();
+    size_t bufferCapacity() const { return buffer.capacity(); };
+};
+
+
+/**
+ * @brief Flyweight factory for tokens, bounded so long sessions do not grow forever
+**/
+class TokenFlyweight {
+private:
+    static Utils::FlyweightFactory<std::string, Token>& factory() {
+        auto& pool = Utils::FlyweightFactory<std::string, Token>::instance();
+        if (!pool.isConfigured()) pool.configure(defaultEntries, defaultBytes, EvictionPolicy::LRU);
+        return pool;
+    }
+    
+public:
+    static constexpr size_t defaultEntries = 4096;
+    static constexpr size_t defaultBytes = 1 << 20;
+
+    static std::shared_ptr<Token> getToken(TokenType type, const std::string& value = "") {
+        auto key = std::to_string(static_cast<int>(type)) + ":" + value;
+        return factory().getFlyweight(key, [type, &value]() {
+            return std::make_shared<Token>(type, value);
+        });
+    }
+    
+    static void configure(size_t maxEntries, size_t maxBytes, EvictionPolicy policy) {
+        factory().configure(maxEntries, maxBytes, policy);
+    }
+    static const PoolStats& stats() { return factory().getStats(); }
+    static void clearCache() { factory().clear(); }
+    static size_t cacheSize() { return factory().size(); }
 };
 
 
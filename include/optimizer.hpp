@@ -0,0 +1,167 @@
+/**
+ * @file include/optimizer.hpp
+ * @brief Simplify an Abstract Syntax Tree (AST) before it is interpreted.
+**/
+
+#pragma once
+#ifndef DEMOLANG_OPTIMIZER
+#define DEMOLANG_OPTIMIZER
+
+#include "ast.hpp"
+#include "builtins.hpp"
+#include "tokens.hpp"
+#include "utils.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using namespace DemoLang;
+using namespace DemoLang::Utils;
+using namespace DemoLang::Tokens;
+using namespace DemoLang::AST;
+using namespace DemoLang::ValueTypes;
+
+
+namespace DemoLang {
+
+namespace OptimizerSpace {
+
+/**
+ * @brief What an expression may evaluate to, a set of these bits.
+**/
+enum Kind : uint8_t {
+    BOOLEAN = 1,        // Integer 0 or 1
+    INTEGER = 2,        // Any other Integer
+    FLOAT = 4,
+    STRING = 8,
+    EXCEPTION = 16,
+    INTEGRAL = BOOLEAN | INTEGER,
+    NUMERIC = INTEGRAL | FLOAT,
+    ANY = NUMERIC | STRING | EXCEPTION
+};
+
+/**
+ * @brief Kinds a unary or binary operator gives for operands of the given kinds.
+ * @note The result follows BinOperatorFactory and UnaryOperatorFactory, it may
+ *       be wider than the actual values but never narrower.
+**/
+uint8_t unaryKinds(Operator op, uint8_t operand);
+uint8_t binaryKinds(Operator op, uint8_t left, uint8_t right);
+
+
+/**
+ * @brief Constant folding and algebraic simplification of pointer trees.
+ * @note Literal-only subtrees are evaluated once, with the same operator
+ *       factories as the interpreter, and replaced by the resulting literal.
+ *       An Exception result becomes an ErrorNode carrying its message.
+ *       x * 1, x + 0, x - 0, -(-x) and !(!x) are reduced to x only when
+ *       the kinds x may take make the rewrite give the same value.
+ *       Left-deep chains such as a + b + c become a single NaryOpNode, which
+ *       keeps the tree shallow and evaluates the chain in one loop.
+**/
+class Optimizer : public Singleton<Optimizer>, public ASTVisitor {
+    friend class Singleton<Optimizer>;
+
+public:
+    struct Stats {
+        size_t folded = 0;          // Operations replaced by their result
+        size_t simplified = 0;      // Identity operations removed
+        size_t flattened = 0;       // Chains of + or * turned into one n-ary node
+    };
+
+private:
+    // A node to visit, first to schedule its operands and then to combine them
+    struct Task {
+        ASTNode* node;
+        bool combine;
+    };
+
+    // A simplified subtree, with the kinds it may evaluate to
+    struct Folded {
+        std::shared_ptr<ASTNode> node;
+        uint8_t kinds;
+        bool changed;
+        uint8_t operandKinds = ANY;     // Unary: kinds of the operand
+        bool fresh = false;             // Created by this pass and referenced nowhere else
+    };
+
+    bool enabled = true;
+    Stats counters;
+    std::shared_ptr<ASTArena> arena;    // New nodes of the tree being optimized
+    std::vector<Task> tasks;
+    std::vector<Folded> built;
+    bool combine = false;
+
+    Folded pop();
+    void fold(const Value& value);
+    void keep(Folded operand);
+
+public:
+    Optimizer() = default;
+
+    void setEnabled(bool enabled) { this->enabled = enabled; }
+    bool isEnabled() const { return enabled; }
+    const Stats& stats() const { return counters; }
+    void resetStats() { counters = Stats(); }
+
+    /**
+     * @brief Simplify a tree.
+     * @return A tree giving the same result as the input, the input itself when
+     *         disabled or when nothing could be simplified.
+     * @note Unchanged subtrees are shared with the input, which the result keeps alive.
+    **/
+    std::shared_ptr<ASTNode> optimize(const std::shared_ptr<ASTNode>& root);
+
+    /**
+     * @brief Value of a literal node, an empty Value for any other node.
+    **/
+    static Value valueOf(ASTNode* node);
+
+    void visit(UnaryOpNode& node) override;
+    void visit(BinaryOpNode& node) override;
+    void visit(NaryOpNode& node) override;
+    void visit(IdNode& node) override;
+    void visit(IntNode& node) override;
+    void visit(FloatNode& node) override;
+    void visit(StringNode& node) override;
+    void visit(ErrorNode& node) override;
+};
+
+
+/**
+ * @brief Dead-statement elimination over a whole program.
+ * @note Evaluation reports errors as values and never by throwing, so a
+ *       statement's only effects are its assignments and, for the last one,
+ *       its value. Any other statement is needed only if it assigns a variable
+ *       that a later needed statement may read before assigning it again.
+**/
+class Liveness : public ASTVisitor {
+private:
+    std::vector<ASTNode*> pending;      // Subtrees of the statement left to scan
+    std::vector<uint32_t> reads;        // Symbols the statement may read
+    std::vector<uint32_t> writes;       // Symbols the statement assigns
+
+public:
+    Liveness() = default;
+
+    /**
+     * @brief Mark the statements the result of the last one depends on.
+     * @return One flag per statement, the last statement is always live.
+    **/
+    std::vector<bool> analyze(const Program& program);
+
+    void visit(UnaryOpNode& node) override;
+    void visit(BinaryOpNode& node) override;
+    void visit(NaryOpNode& node) override;
+    void visit(IdNode& node) override;
+    void visit(IntNode&) override {}
+    void visit(FloatNode&) override {}
+    void visit(StringNode&) override {}
+    void visit(ErrorNode&) override {}
+};
+
+} // namespace OptimizerSpace
+
+} // namespace DemoLang
+
+#endif // DEMOLANG_OPTIMIZER
@@ -10,6 +10,7 @@
 #include "tokens.hpp"
 #include "lexer.hpp"
 #include "ast.hpp"
+#include <array>
 #include <memory>
 #include <vector>
 
@@ -23,6 +24,34 @@ namespace DemoLang {
 
 namespace ParserSpace {
 
+/**
+ * @brief Binding power of each binary operator, indexed by operator id.
+ * @note Higher binds tighter, 0 marks an operator that is not binary.
+**/
+constexpr std::array<uint8_t, operatorCount> binaryPrecedence = []() {
+    std::array<uint8_t, operatorCount> table{};
+    auto set = [&table](Operator op, uint8_t precedence) { table[static_cast<size_t>(op)] = precedence; };
+    set(Operator::ASSIGN, 1);
+    set(Operator::AND, 2);              set(Operator::OR, 2);
+    set(Operator::EQUAL, 3);            set(Operator::NOT_EQUAL, 3);
+    set(Operator::LESS, 4);             set(Operator::LESS_EQUAL, 4);
+    set(Operator::GREATER, 4);          set(Operator::GREATER_EQUAL, 4);
+    set(Operator::PLUS, 5);             set(Operator::MINUS, 5);
+    set(Operator::MULTIPLY, 6);         set(Operator::DIVIDE, 6);
+    return table;
+}();
+
+/**
+ * @brief Whether each operator may prefix an operand, indexed by operator id.
+**/
+constexpr std::array<bool, operatorCount> unaryOperator = []() {
+    std::array<bool, operatorCount> table{};
+    table[static_cast<size_t>(Operator::NOT)] = true;
+    table[static_cast<size_t>(Operator::MINUS)] = true;
+    return table;
+}();
+
+
 /**
  * @brief Parser class for converting tokens to AST.
 **/
@@ -30,58 +59,203 @@ class Parser : public Singleton<Parser> {
     friend class Singleton<Parser>;
 
 private:
-    std::vector<Token> tokens;
-    size_t current_pos;
+    TokenStream owned;
+    Generator<TokenView> source;
+    TokenView head;
+    std::shared_ptr<ASTArena> arena;
+    Utils::InternPool<std::string, ASTNode> cache;
+
+    // Replays a materialized stream through the same pull interface
+    static Generator<TokenView> replay(const TokenStream& tokens);
+    // Parses one root into the current arena
+    std::shared_ptr<ASTNode> parseRoot(Generator<TokenView> tokens);
 
 public:
-    Parser() : current_pos(0) {};
+    static constexpr size_t defaultCacheEntries = 1024;
+    static constexpr size_t defaultCacheBytes = 4 << 20;
+    static constexpr size_t defaultMaxDepth = 10000;
+
+    Parser() : head{TokenType::END, ""} {
+        cache.configure(defaultCacheEntries, defaultCacheBytes, EvictionPolicy::LRU);
+    }
     
-    Token current() const { return current_pos < tokens.size() ? tokens[current_pos] : Token(TokenType::END, ""); }
-    void advance() { if (current_pos < tokens.size()) current_pos++; }
-    bool match(TokenType type, const std::string& value);
+    TokenView current() const { return head; }
+    void advance() {
+        // Tokens are pulled one at a time, END is never passed
+        if (head.type == TokenType::END) return;
+        head = source.next() ? source.value() : TokenView{TokenType::END, ""};
+    }
+    bool match(TokenType type, std::string_view value);
     std::shared_ptr<ASTNode> parse(const std::vector<Token> &tokens);
-    std::shared_ptr<ASTNode> parseExpression();
-};
+    std::shared_ptr<ASTNode> parse(const TokenStream &tokens);
 
+    /**
+     * @brief Parse tokens pulled lazily from a generator.
+     * @param tokens The token source, consumed only as far as the expression needs.
+     * @return The AST of the first expression.
+    **/
+    std::shared_ptr<ASTNode> parse(Generator<TokenView> tokens);
 
-class BaseParser : public Handler<ASTNode> {
-protected:
-    Parser& parser;
+    /**
+     * @brief Lex and parse a source in one pass, without an intermediate token buffer.
+     * @param source The source text.
+     * @return The same AST as parse(Lexer::scan(source)).
+     * @note Trees are cached by their exact source text, so a repeated source
+     *       skips the lexer and the parser and gets the same, immutable tree.
+     *       A cached tree owns its arena and holds its flyweight leaves, so
+     *       evicting from the cache or from the flyweight pools never
+     *       invalidates a tree the other one still hands out.
+    **/
+    std::shared_ptr<ASTNode> parseSource(std::string_view source);
 
-public:
-    BaseParser(Parser& parser) : parser(parser) {};
-    virtual std::shared_ptr<ASTNode> handle() = 0;
-};
+    /**
+     * @brief Bound the source cache, a limit of 0 means unbounded.
+    **/
+    void configureCache(size_t maxEntries, size_t maxBytes, EvictionPolicy policy = EvictionPolicy::LRU) {
+        cache.configure(maxEntries, maxBytes, policy);
+    }
+    const PoolStats& cacheStats() const { return cache.getStats(); }
+    void resetCacheStats() { cache.resetStats(); }
+    void clearCache() { cache.clear(); }
+    size_t cacheSize() const { return cache.size(); }
+
+    /**
+     * @brief Parse a whole script into its statements.
+     * @param source The script, one statement per line.
+     * @return Every non-blank statement with the line it starts on.
+     * @note Every line is lexed on its own, exactly as a single line would be.
+     *       A statement goes on to the next line while it leaves parentheses
+     *       open, and whitespace at the line breaks inside it is ignored.
+     *       Lines whose parentheses never close, or that do not parse
+     *       together, are parsed one by one instead.
+    **/
+    Program parseProgram(std::string_view source);
+    std::shared_ptr<ASTNode> parseExpression();
+
+    /**
+     * @brief Create a node in the arena of the tree being parsed.
+    **/
+    template <typename T, typename... Args>
+    std::shared_ptr<ASTNode> make(Args&&... args) {
+        if (!arena) return std::make_shared<T>(std::forward<Args>(args)...);
+        return arena->make<T>(std::forward<Args>(args)...);
+    }
 
+    /**
+     * @brief Take a node shared with other trees into the tree being parsed.
+    **/
+    std::shared_ptr<ASTNode> adopt(std::shared_ptr<ASTNode> node) {
+        return arena ? arena->adopt(std::move(node)) : node;
+    }
+
+    /**
+     * @brief Limit how deeply parentheses may nest, deeper input parses to an ErrorNode.
+    **/
+    void setMaxDepth(size_t depth) {
+        maxDepth = depth;
+        cache.clear();  // Cached trees were parsed under the old limit
+    }
+    size_t getMaxDepth() const { return maxDepth; }
 
-class UnaryParser : public BaseParser {
 private:
-    std::vector<std::string> operators;
+    // A construct waiting for an operand, kept on the heap instead of the call stack
+    struct Frame {
+        enum Kind : uint8_t { BINARY, UNARY, GROUP } kind;
+        uint8_t minPrecedence;              // Binary: loosest operator it may take
+        Operator op;                        // Unary operator, or the binary one waiting for its right operand
+        std::shared_ptr<ASTNode> left;      // Binary: left operand of op
 
-public:
-    UnaryParser(Parser& parser, std::vector<std::string> operators)
-        : BaseParser(parser), operators(operators) {};
-    std::shared_ptr<ASTNode> handle() override;
+        Frame(Kind kind, uint8_t minPrecedence = 0, Operator op = Operator::NONE)
+            : kind(kind), minPrecedence(minPrecedence), op(op) {}
+    };
+
+    size_t maxDepth = defaultMaxDepth;
+
+    // Operator id of the current token, Operator::NONE if it is not an operator
+    Operator currentOperator() const {
+        if (head.type != TokenType::OPERATOR) return Operator::NONE;
+        return head.hasLiteral ? head.literal.op : operatorOf(head.value);
+    }
+    std::shared_ptr<ASTNode> parsePrimary();
 };
 
 
-class BinaryParser : public BaseParser {
+/**
+ * @brief Flyweight factory for AST nodes, bounded so long sessions do not grow forever
+**/
+class ASTFlyweight {
 private:
-    std::vector<std::string> operators;
+    // Shortest text that round-trips, so distinct values never share a key
+    template <typename T>
+    static std::string literalKey(T value) {
+        char buffer[64];
+        auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        return std::string(buffer, end);
+    }
 
+    static Utils::FlyweightFactory<std::string, ASTNode>& factory() {
+        auto& pool = Utils::FlyweightFactory<std::string, ASTNode>::instance();
+        if (!pool.isConfigured()) pool.configure(defaultEntries, defaultBytes, EvictionPolicy::LRU);
+        return pool;
+    }
+
+    // Identifiers are keyed by symbol id, so looking one up hashes no text
+    static Utils::FlyweightFactory<uint32_t, ASTNode>& symbols() {
+        auto& pool = Utils::FlyweightFactory<uint32_t, ASTNode>::instance();
+        if (!pool.isConfigured()) pool.configure(defaultEntries, defaultBytes, EvictionPolicy::LRU);
+        return pool;
+    }
+    
 public:
-    BinaryParser(Parser& parser, std::vector<std::string> operators)
-        : BaseParser(parser), operators(operators) {};
-    std::shared_ptr<ASTNode> handle() override;
-};
+    static constexpr size_t defaultEntries = 4096;
+    static constexpr size_t defaultBytes = 1 << 20;
 
+    static std::shared_ptr<ASTNode> getIdNode(uint32_t symbol) {
+        return symbols().getFlyweight(symbol, [symbol]() {
+            return std::make_shared<IdNode>(symbol);
+        });
+    }
 
-class PrimaryParser : public BaseParser {
-public:
-    PrimaryParser(Parser& parser) : BaseParser(parser) {};
-    std::shared_ptr<ASTNode> handle() override;
+    static std::shared_ptr<ASTNode> getIdNode(std::string_view name) {
+        return getIdNode(Utils::SymbolTable::instance().intern(name));
+    }
+    
+    static std::shared_ptr<ASTNode> getIntNode(long long value) {
+        std::string key = "int:" + literalKey(value);
+        return factory().getFlyweight(key, [value]() {
+            return std::make_shared<IntNode>(value);
+        });
+    }
+    
+    static std::shared_ptr<ASTNode> getFloatNode(long double value) {
+        std::string key = "float:" + literalKey(value);
+        return factory().getFlyweight(key, [value]() {
+            return std::make_shared<FloatNode>(value);
+        });
+    }
+    
+    static std::shared_ptr<ASTNode> getStringNode(std::string_view value) {
+        std::string key = "string:" + std::string(value);
+        return factory().getFlyweight(key, [&value]() {
+            return std::make_shared<StringNode>(std::string(value));
+        });
+    }
+    
+    static void configure(size_t maxEntries, size_t maxBytes, EvictionPolicy policy) {
+        factory().configure(maxEntries, maxBytes, policy);
+        symbols().configure(maxEntries, maxBytes, policy);
+    }
+    static PoolStats stats() {
+        const PoolStats& literals = factory().getStats();
+        const PoolStats& identifiers = symbols().getStats();
+        return {literals.hits + identifiers.hits, literals.misses + identifiers.misses,
+                literals.evictions + identifiers.evictions};
+    }
+    static void clearCache() { factory().clear(); symbols().clear(); }
+    static size_t cacheSize() { return factory().size() + symbols().size(); }
 };
 
+
 } // namespace ParserSpace
 
 } // namespace DemoLang
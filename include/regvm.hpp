@@ -0,0 +1,160 @@
+/**
+ * @file include/regvm.hpp
+ * @brief Compile an Abstract Syntax Tree (AST) to three-address code and run it on a register machine.
+**/
+
+#pragma once
+#ifndef DEMOLANG_REGVM
+#define DEMOLANG_REGVM
+
+#include "vm.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace DemoLang {
+
+namespace VMSpace {
+
+/**
+ * @brief Three-address code of one statement.
+ * @note Instructions read and write slots of a frame laid out as the
+ *       constants, the registers and the chain slots, so an operand is one
+ *       index whether it is a literal or a computed value, and literals need
+ *       no instruction to load them. Chain slots hold the operands of a CHAIN
+ *       side by side, a nested chain takes the slots above its parent's.
+**/
+class RegisterProgram {
+    friend class RegisterCompiler;
+
+public:
+    enum class Op : uint8_t {
+        GET,                // dst = variable a
+        SET,                // variable a = b
+        MOVE,               // dst = a
+        NEG, NOT,           // dst = op a
+        UNARY,              // dst = op a, with an operator that is not a unary one
+        ADD, SUB, MUL, DIV,
+        EQ, NE, LT, LE, GT, GE,
+        AND, OR,            // dst = a op b
+        BINARY,             // dst = a op b, with an operator that is not a binary one
+        CHAIN,              // dst = op over the b slots from a, as executeChain
+        FAIL,               // Stop with the constant a as the result
+        RETURN              // Stop with a as the result
+    };
+    static constexpr size_t opCount = static_cast<size_t>(Op::RETURN) + 1;
+
+    struct Instruction {
+        Op op;
+        Operator aux;       // Operator of UNARY, BINARY and CHAIN
+        uint32_t dst;
+        uint32_t a;         // Slot, or symbol id of GET and SET
+        uint32_t b;         // Slot, or operand count of CHAIN
+    };
+
+private:
+    std::vector<Instruction> code;
+    std::vector<Value> constants;
+    uint32_t registerCount = 0;
+    uint32_t chainCount = 0;
+
+public:
+    RegisterProgram() = default;
+
+    const std::vector<Instruction>& getCode() const { return code; }
+    const std::vector<Value>& getConstants() const { return constants; }
+    uint32_t getRegisterCount() const { return registerCount; }
+    uint32_t getChainCount() const { return chainCount; }
+    size_t getFrameSize() const { return constants.size() + registerCount + chainCount; }
+    size_t size() const { return code.size(); }
+    bool empty() const { return code.empty(); }
+
+    /**
+     * @brief Constants, then one line per instruction, e.g. "0002 ADD r0, k0, r1".
+    **/
+    std::string disassemble() const;
+
+    static const char* name(Op op);
+};
+
+
+/**
+ * @brief Compiler from pointer trees to three-address code.
+ * @note Each value first gets a virtual register of its own. Linear scan
+ *       then maps them to the fewest frame registers, a register is free
+ *       again once the instruction reading its last value ran. The frame
+ *       is sized at compile time and nothing is ever spilled. A chain whose
+ *       operands are all numeric is combined pair by pair as its operands
+ *       come, any other one moves them into chain slots for one CHAIN.
+**/
+class RegisterCompiler : public TreeCompiler {
+private:
+    // Operand before allocation: a virtual register, or a constant or chain slot when a flag is set
+    static constexpr uint32_t constantFlag = 1u << 31;
+    static constexpr uint32_t chainFlag = 1u << 30;
+    // Slot of a chain's combine steps: the chain slot receiving the value just compiled,
+    // pairSlot to combine one pair of a numeric chain, or noSlot to combine the whole chain
+    static constexpr uint32_t pairSlot = UINT32_MAX - 1;
+
+    RegisterProgram program;
+    std::vector<uint32_t> values;   // Operands of the nodes compiled so far
+    uint32_t virtuals = 0;
+    uint32_t chainTop = 0;          // Chain slots taken by the chains being compiled
+    std::unordered_map<std::string, uint32_t> pool;
+
+    uint32_t constant(const Value& value);
+    uint32_t pop();
+    void emit(RegisterProgram::Op op, Operator aux, uint32_t a, uint32_t b);
+    void allocate();
+
+public:
+    RegisterCompiler() = default;
+
+    /**
+     * @brief Compile a tree, the code returns the value Interpreter::evaluate gives.
+    **/
+    RegisterProgram compile(ASTNode& root);
+
+    void visit(UnaryOpNode& node) override;
+    void visit(BinaryOpNode& node) override;
+    void visit(NaryOpNode& node) override;
+    void visit(IdNode& node) override;
+    void visit(IntNode& node) override;
+    void visit(FloatNode& node) override;
+    void visit(StringNode& node) override;
+    void visit(ErrorNode& node) override;
+};
+
+
+/**
+ * @brief Register machine running compiled programs.
+ * @note Dispatches like VM. Variables live in the machine's own environment.
+**/
+class RegisterVM : public Singleton<RegisterVM> {
+    friend class Singleton<RegisterVM>;
+
+private:
+    Environment env = Environment();
+    std::vector<Value> frame;
+
+public:
+    RegisterVM() = default;
+
+    Value run(const RegisterProgram& program);
+    std::string interpret(const RegisterProgram& program);
+
+    /**
+     * @brief Compile a tree and run it.
+     * @return The same text Interpreter::interpret gives for the tree.
+    **/
+    std::string interpret(const std::shared_ptr<ASTNode>& node);
+};
+
+} // namespace VMSpace
+
+} // namespace DemoLang
+
+#endif // DEMOLANG_REGVM
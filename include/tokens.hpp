@@ -7,7 +7,11 @@
 #ifndef DEMOLANG_TOKENS
 #define DEMOLANG_TOKENS
 
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "utils.hpp"
 
@@ -19,7 +23,7 @@ namespace Tokens {
 /**
  * @brief Token types used in the lexical analysis.
 **/
-enum class TokenType {
+enum class TokenType : uint8_t {
     END,                // End of input
     OPERATOR,           // Plus, minus, multiply, divide, etc.
     IDENTIFIER,         // Variable names, function names, etc.
@@ -49,6 +53,55 @@ const std::vector<std::string> operators = {
 };
 
 
+/**
+ * @brief Operator ids, in the same order as the operators list.
+**/
+enum class Operator : uint8_t {
+    EQUAL, NOT_EQUAL, GREATER_EQUAL, LESS_EQUAL, GREATER, LESS,
+    ASSIGN, LEFT_PAREN, RIGHT_PAREN, LEFT_BRACE, RIGHT_BRACE,
+    PLUS, MINUS, MULTIPLY, DIVIDE,
+    NOT, AND, OR,
+    NONE
+};
+
+constexpr size_t operatorCount = static_cast<size_t>(Operator::NONE);
+
+
+/**
+ * @brief Get the id of an operator from its text.
+ * @return Operator::NONE if the text is not an operator.
+**/
+constexpr Operator operatorOf(std::string_view text) {
+    if (text.size() == 2 && text[1] == '=') {
+        switch (text[0]) {
+            case '=': return Operator::EQUAL;
+            case '!': return Operator::NOT_EQUAL;
+            case '>': return Operator::GREATER_EQUAL;
+            case '<': return Operator::LESS_EQUAL;
+            default:  return Operator::NONE;
+        }
+    }
+    if (text.size() != 1) return Operator::NONE;
+    switch (text[0]) {
+        case '>': return Operator::GREATER;
+        case '<': return Operator::LESS;
+        case '=': return Operator::ASSIGN;
+        case '(': return Operator::LEFT_PAREN;
+        case ')': return Operator::RIGHT_PAREN;
+        case '{': return Operator::LEFT_BRACE;
+        case '}': return Operator::RIGHT_BRACE;
+        case '+': return Operator::PLUS;
+        case '-': return Operator::MINUS;
+        case '*': return Operator::MULTIPLY;
+        case '/': return Operator::DIVIDE;
+        case '!': return Operator::NOT;
+        case '&': return Operator::AND;
+        case '|': return Operator::OR;
+        default:  return Operator::NONE;
+    }
+}
+
+
 /**
  * @brief Token structure representing a lexical unit.
 **/
@@ -58,6 +111,149 @@ struct Token {
     Token(TokenType type, const std::string &value) : type(type), value(value) {}
 };
 
+
+/**
+ * @brief Value carried by a token: a number for literals, a symbol id for
+ *        identifiers and an operator id for operators.
+**/
+union TokenLiteral {
+    long long integer;
+    double floating;
+    uint32_t symbol;
+    Operator op;
+};
+
+
+/**
+ * @brief Parse the value of a token once, straight from its text.
+ * @param type The token type, literals carry a number, identifiers a symbol and operators an id.
+ * @param text The token text.
+ * @param literal Receives the value.
+ * @return False when there is no value or it is out of range.
+**/
+inline bool parseLiteral(TokenType type, std::string_view text, TokenLiteral& literal) {
+    if (type == TokenType::IDENTIFIER) {
+        literal.symbol = Utils::SymbolTable::instance().intern(text);
+        return true;
+    }
+    if (type == TokenType::OPERATOR) {
+        literal.op = operatorOf(text);
+        return literal.op != Operator::NONE;
+    }
+    const char* first = text.data();
+    const char* last = first + text.size();
+    if (type == TokenType::INTEGER_LITERAL) {
+        // Like std::stoll, a valid prefix is enough
+        return std::from_chars(first, last, literal.integer).ec == std::errc();
+    }
+    if (type == TokenType::FLOAT_LITERAL) {
+        // Parsed as long double and rounded through double, like std::strtold used to be
+        long double value;
+        auto [end, ec] = std::from_chars(first, last, value);
+        literal.floating = static_cast<double>(value);
+        return ec == std::errc() && end == last;
+    }
+    return false;
+}
+
+
+/**
+ * @brief Non-owning view of a token, valid while its stream is alive.
+**/
+struct TokenView {
+    TokenType type;
+    std::string_view value;
+    bool hasLiteral = false;
+    TokenLiteral literal = {0};
+};
+
+
+/**
+ * @brief Compact token locating its text in the buffer of a token stream.
+**/
+struct TokenSpan {
+    TokenType type;
+    bool hasLiteral;        // Value parsed, and in range for numbers
+    uint32_t offset;
+    uint32_t length;
+    TokenLiteral literal;
+};
+
+
+/**
+ * @brief Token sequence backed by the source buffer it was scanned from.
+ * @note Error messages do not occur in the source, so they are kept in a
+ *       separate diagnostics buffer that error spans point into. Spans hold
+ *       32-bit offsets, so a source of 4 GiB or more is rejected with
+ *       std::length_error rather than pointing spans at the wrong text.
+**/
+class TokenStream {
+private:
+    std::string source;
+    std::string diagnostics;
+    std::vector<TokenSpan> spans;
+
+    static void checkSize(size_t size) {
+        if (size > maxSize) throw std::length_error("Source too large to scan, the limit is 4 GiB");
+    }
+
+public:
+    static constexpr size_t maxSize = UINT32_MAX;
+
+    TokenStream() = default;
+    explicit TokenStream(std::string source) : source(std::move(source)) { checkSize(this->source.size()); }
+    explicit TokenStream(const std::vector<Token>& tokens) {
+        // Lay the token values out back to back as the source buffer,
+        // except error messages, which go to the diagnostics buffer
+        for (const auto& token : tokens) {
+            if (token.type != TokenType::ERROR) source += token.value;
+        }
+        checkSize(source.size());
+        size_t offset = 0;
+        for (const auto& token : tokens) {
+            if (token.type == TokenType::ERROR) {
+                pushError(token.value);
+                continue;
+            }
+            push(token.type, offset, token.value.size());
+            offset += token.value.size();
+        }
+    }
+
+    const std::string& getSource() const { return source; }
+    const std::vector<TokenSpan>& getSpans() const { return spans; }
+    size_t size() const { return spans.size(); }
+
+    static TokenSpan span(std::string_view source, TokenType type, size_t offset, size_t length) {
+        TokenSpan span = {type, false, static_cast<uint32_t>(offset), static_cast<uint32_t>(length), {0}};
+        span.hasLiteral = parseLiteral(type, source.substr(offset, length), span.literal);
+        return span;
+    }
+    void push(const TokenSpan& span) { spans.push_back(span); }
+    void push(TokenType type, size_t offset, size_t length) { spans.push_back(span(source, type, offset, length)); }
+    void pushError(const std::string& message) {
+        checkSize(diagnostics.size() + message.size());
+        spans.push_back({TokenType::ERROR, false, static_cast<uint32_t>(diagnostics.size()), static_cast<uint32_t>(message.size()), {0}});
+        diagnostics += message;
+    }
+
+    std::string_view text(const TokenSpan& span) const {
+        const std::string& buffer = span.type == TokenType::ERROR ? diagnostics : source;
+        return std::string_view(buffer).substr(span.offset, span.length);
+    }
+    TokenView operator[](size_t index) const {
+        const TokenSpan& span = spans[index];
+        return {span.type, text(span), span.hasLiteral, span.literal};
+    }
+
+    std::vector<Token> toTokens() const {
+        std::vector<Token> tokens;
+        tokens.reserve(spans.size());
+        for (const auto& span : spans) tokens.emplace_back(span.type, std::string(text(span)));
+        return tokens;
+    }
+};
+
 } // namespace Tokens
 
 } // namespace DemoLang
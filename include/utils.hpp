@@ -7,12 +7,25 @@
 #ifndef DEMOLANG_UTILS
 #define DEMOLANG_UTILS
 
+#include <algorithm>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <list>
 #include <unordered_map>
 #include <vector>
 #include <functional>
+#include <shared_mutex>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 
 
 namespace DemoLang {
@@ -61,6 +74,67 @@ public:
 };
 
 
+/**
+ * @brief Lazily evaluated sequence produced by a coroutine
+ * @tparam T The value type yielded by the coroutine
+ */
+template <typename T>
+class Generator {
+public:
+    struct promise_type {
+        T current{};
+        std::exception_ptr exception;
+
+        Generator get_return_object() {
+            return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always yield_value(T value) {
+            current = std::move(value);
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+private:
+    std::coroutine_handle<promise_type> handle;
+
+    explicit Generator(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+public:
+    Generator() = default;
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+    Generator(Generator&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Generator& operator=(Generator&& other) noexcept {
+        if (this != &other) {
+            if (handle) handle.destroy();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    ~Generator() { if (handle) handle.destroy(); }
+
+    /**
+     * @brief Run the coroutine up to its next value
+     * @return False once the coroutine has finished
+     */
+    bool next() {
+        if (!handle || handle.done()) return false;
+        handle.resume();
+        if (handle.promise().exception) std::rethrow_exception(handle.promise().exception);
+        return !handle.done();
+    }
+
+    /**
+     * @brief The value produced by the last successful call to next()
+     */
+    const T& value() const { return handle.promise().current; }
+};
+
+
 /**
  * @brief Singleton class template
  * @tparam T singleton class type
@@ -85,6 +159,137 @@ public:
 };
 
 
+/**
+ * @brief Process-wide table mapping names to dense 32-bit symbol ids
+ * @note Safe to use from several threads, names are never released
+ */
+class SymbolTable : public Singleton<SymbolTable> {
+    friend class Singleton<SymbolTable>;
+
+private:
+    mutable std::shared_mutex mutex;
+    // A deque never moves its elements, so the keys may view into it
+    std::deque<std::string> names;
+    std::unordered_map<std::string_view, uint32_t> ids;
+
+    SymbolTable() = default;
+
+public:
+    /**
+     * @brief Get the id of a name, assigning the next free one if it is new
+     */
+    uint32_t intern(std::string_view name) {
+        {
+            std::shared_lock lock(mutex);
+            auto it = ids.find(name);
+            if (it != ids.end()) return it->second;
+        }
+        std::unique_lock lock(mutex);
+        // Another thread may have interned it between the two locks
+        auto it = ids.find(name);
+        if (it != ids.end()) return it->second;
+        uint32_t id = static_cast<uint32_t>(names.size());
+        names.emplace_back(name);
+        ids.emplace(names.back(), id);
+        return id;
+    }
+
+    /**
+     * @brief Get the name of an interned symbol
+     */
+    const std::string& name(uint32_t id) const {
+        std::shared_lock lock(mutex);
+        if (id >= names.size()) throw std::out_of_range("Unknown symbol id");
+        return names[id];
+    }
+
+    size_t size() const {
+        std::shared_lock lock(mutex);
+        return names.size();
+    }
+};
+
+
+/**
+ * @brief Bump allocator releasing everything it created at once
+ * @note Objects are destroyed in reverse order of creation when the arena is,
+ *       those with trivial destructors are only released with their block.
+ */
+class Arena {
+private:
+    struct Finalizer {
+        void (*destroy)(void*);
+        void* object;
+    };
+
+    std::vector<std::unique_ptr<std::byte[]>> blocks;
+    std::byte* cursor = nullptr;
+    size_t remaining = 0;
+    size_t blockSize;
+    size_t used = 0;
+    size_t reserved = 0;
+    std::vector<Finalizer> finalizers;
+    std::vector<std::shared_ptr<void>> retained;
+
+public:
+    static constexpr size_t defaultBlockSize = 64 * 1024;
+
+    explicit Arena(size_t blockSize = defaultBlockSize) : blockSize(blockSize) {}
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    ~Arena() {
+        for (auto it = finalizers.rbegin(); it != finalizers.rend(); ++it) it->destroy(it->object);
+    }
+
+    /**
+     * @brief Reserve raw memory, taking a new block when the current one is full
+     */
+    void* allocate(size_t size, size_t alignment) {
+        size_t padding = (alignment - reinterpret_cast<uintptr_t>(cursor) % alignment) % alignment;
+        if (!cursor || padding + size > remaining) {
+            // Oversized requests get a block of their own
+            size_t capacity = std::max(blockSize, size + alignment);
+            blocks.push_back(std::unique_ptr<std::byte[]>(new std::byte[capacity]));
+            reserved += capacity;
+            cursor = blocks.back().get();
+            remaining = capacity;
+            padding = (alignment - reinterpret_cast<uintptr_t>(cursor) % alignment) % alignment;
+        }
+        void* memory = cursor + padding;
+        cursor += padding + size;
+        remaining -= padding + size;
+        used += size;
+        return memory;
+    }
+
+    /**
+     * @brief Construct an object in the arena, it lives as long as the arena
+     */
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        // Room for the finalizer is made first, so a failed push cannot leak an object
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            if (finalizers.size() == finalizers.capacity()) finalizers.reserve(std::max<size_t>(64, finalizers.size() * 2));
+        }
+        T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            finalizers.push_back({[](void* object) { static_cast<T*>(object)->~T(); }, object});
+        }
+        return object;
+    }
+
+    /**
+     * @brief Keep an object that lives outside the arena alive for as long as the arena
+     */
+    void retain(std::shared_ptr<void> owner) { retained.push_back(std::move(owner)); }
+
+    size_t bytesUsed() const { return used; }
+    size_t blockCount() const { return blocks.size(); }
+    size_t bytesReserved() const { return reserved; }
+    size_t objectCount() const { return finalizers.size(); }
+};
+
+
 /**
  * @brief Simplified factory pattern template using creator-based registration only
  * @tparam KeyType The key type for registration (e.g., std::string)
@@ -196,6 +401,152 @@ public:
     }
 };
 
+/**
+ * @brief Policies deciding which entry a bounded pool evicts first
+ */
+enum class EvictionPolicy {
+    LRU,    // Least recently used entry
+    CLOCK   // Second chance sweep approximating LRU
+};
+
+/**
+ * @brief Usage counters of an interning pool
+ */
+struct PoolStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+};
+
+/**
+ * @brief Interning pool bounded by entry count and estimated bytes
+ * @tparam KeyType The key type for lookup
+ * @tparam ObjectType The object type to be shared
+ * @tparam HashType The hash function type (defaults to std::hash<KeyType>)
+ * @note Evicted objects stay valid for as long as someone holds them, the pool
+ *       only drops its own reference. A limit of 0 means unbounded.
+ */
+template <typename KeyType, typename ObjectType, typename HashType = std::hash<KeyType>>
+class InternPool {
+private:
+    struct Entry {
+        KeyType key;
+        std::shared_ptr<ObjectType> object;
+        size_t bytes;
+        bool referenced;
+    };
+    using Iterator = typename std::list<Entry>::iterator;
+
+    // Recency order for LRU (most recent first), ring order for CLOCK
+    std::list<Entry> entries;
+    std::unordered_map<KeyType, Iterator, HashType> index;
+    Iterator hand = entries.end();
+    EvictionPolicy policy = EvictionPolicy::LRU;
+    size_t maxEntries = 0;
+    size_t maxBytes = 0;
+    size_t totalBytes = 0;
+    bool configured = false;
+    PoolStats stats;
+
+    static size_t weigh(const KeyType& key) {
+        size_t bytes = sizeof(Entry) + sizeof(ObjectType);
+        if constexpr (std::is_same_v<KeyType, std::string>) bytes += key.capacity();
+        return bytes;
+    }
+
+    Iterator victim() {
+        if (policy == EvictionPolicy::LRU) return std::prev(entries.end());
+        // Sweep the clock hand, giving referenced entries a second chance
+        while (true) {
+            if (hand == entries.end()) hand = entries.begin();
+            if (!hand->referenced) return hand;
+            hand->referenced = false;
+            ++hand;
+        }
+    }
+
+    void evict() {
+        while (!entries.empty() && ((maxEntries && entries.size() > maxEntries) || (maxBytes && totalBytes > maxBytes))) {
+            Iterator it = victim();
+            if (it == hand) ++hand;
+            totalBytes -= it->bytes;
+            index.erase(it->key);
+            entries.erase(it);
+            stats.evictions++;
+        }
+    }
+
+public:
+    /**
+     * @brief Set the limits and policy, evicting entries beyond the new limits
+     * @param maxEntries Maximum number of entries (0 for unbounded)
+     * @param maxBytes Maximum estimated bytes held by the pool (0 for unbounded)
+     * @param policy Eviction policy
+     */
+    void configure(size_t maxEntries, size_t maxBytes, EvictionPolicy policy = EvictionPolicy::LRU) {
+        this->maxEntries = maxEntries;
+        this->maxBytes = maxBytes;
+        this->policy = policy;
+        configured = true;
+        evict();
+    }
+
+    /**
+     * @brief Get the shared object for a key, creating it on a miss
+     * @param key The lookup key
+     * @param creator Creates the object when the key is not pooled
+     * @return The shared object
+     */
+    std::shared_ptr<ObjectType> get(const KeyType& key, const std::function<std::shared_ptr<ObjectType>()>& creator) {
+        if (auto found = find(key)) return found;
+        auto obj = creator();
+        insert(key, obj);
+        return obj;
+    }
+
+    /**
+     * @brief Look up a key, counting a hit or a miss
+     * @return The pooled object, or nullptr on a miss
+     */
+    std::shared_ptr<ObjectType> find(const KeyType& key) {
+        auto it = index.find(key);
+        if (it == index.end()) {
+            stats.misses++;
+            return nullptr;
+        }
+        stats.hits++;
+        if (policy == EvictionPolicy::LRU) entries.splice(entries.begin(), entries, it->second);
+        else it->second->referenced = true;
+        return it->second->object;
+    }
+
+    /**
+     * @brief Pool an object under a key that is not pooled yet
+     * @param weight Bytes the object holds beyond its own size, e.g. its children
+     */
+    void insert(const KeyType& key, std::shared_ptr<ObjectType> obj, size_t weight = 0) {
+        if (index.count(key)) return;
+        // New entries go to the front for LRU and just behind the hand for CLOCK
+        Iterator pos = policy == EvictionPolicy::LRU ? entries.begin() : hand;
+        Iterator entry = entries.insert(pos, Entry{key, std::move(obj), weigh(key) + weight, false});
+        index.emplace(key, entry);
+        totalBytes += entry->bytes;
+        evict();
+    }
+
+    void clear() {
+        entries.clear();
+        index.clear();
+        hand = entries.end();
+        totalBytes = 0;
+    }
+    size_t size() const { return entries.size(); }
+    size_t bytes() const { return totalBytes; }
+    bool isConfigured() const { return configured; }
+    const PoolStats& getStats() const { return stats; }
+    void resetStats() { stats = PoolStats(); }
+};
+
 /**
  * @brief Flyweight pattern implementation for managing shared objects
  * @tparam KeyType The key type for flyweight lookup
@@ -203,27 +554,16 @@ public:
  * @tparam HashType The hash function type (defaults to std::hash<KeyType>)
  */
 template <typename KeyType, typename ObjectType, typename HashType = std::hash<KeyType>>
-class FlyweightFactory : public Singleton<FlyweightFactory<KeyType, ObjectType, HashType>> {
+class FlyweightFactory : public InternPool<KeyType, ObjectType, HashType>,
+                         public Singleton<FlyweightFactory<KeyType, ObjectType, HashType>> {
 private:
-    std::unordered_map<KeyType, std::shared_ptr<ObjectType>, HashType> pool;
-    
     FlyweightFactory() = default;
     friend class Singleton<FlyweightFactory<KeyType, ObjectType, HashType>>;
     
 public:
     std::shared_ptr<ObjectType> getFlyweight(const KeyType& key, std::function<std::shared_ptr<ObjectType>()> creator) {
-        auto it = pool.find(key);
-        if (it != pool.end()) {
-            return it->second;
-        }
-        
-        auto obj = creator();
-        pool[key] = obj;
-        return obj;
+        return this->get(key, creator);
     }
-    
-    void clear() { pool.clear(); }
-    size_t size() const { return pool.size(); }
 };
 
 
@@ -0,0 +1,217 @@
+/**
+ * @file include/vm.hpp
+ * @brief Compile an Abstract Syntax Tree (AST) to bytecode and run it on a stack machine.
+**/
+
+#pragma once
+#ifndef DEMOLANG_VM
+#define DEMOLANG_VM
+
+#include "ast.hpp"
+#include "builtins.hpp"
+#include "interpreter.hpp"
+#include "tokens.hpp"
+#include "utils.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Engines jump straight from one instruction to the next with computed gotos where the compiler has them
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(DEMOLANG_SWITCH_DISPATCH)
+#define DEMOLANG_THREADED_DISPATCH
+#endif
+
+using namespace DemoLang;
+using namespace DemoLang::Utils;
+using namespace DemoLang::Tokens;
+using namespace DemoLang::AST;
+using namespace DemoLang::ValueTypes;
+using namespace DemoLang::InterpreterSpace;
+
+
+namespace DemoLang {
+
+namespace VMSpace {
+
+/**
+ * @brief One-byte instruction, followed by its operands in the code.
+**/
+enum class Opcode : uint8_t {
+    CONSTANT,           // u32 constant index: push the constant
+    LOAD,               // u32 symbol id: push the variable
+    STORE,              // u32 symbol id: assign the top, which stays
+    POP,                // Drop the top
+    NEG, NOT,           // Replace the top by the result
+    UNARY,              // u8 operator id: an operator that is not a unary one
+    ADD, SUB, MUL, DIV,
+    EQ, NE, LT, LE, GT, GE,
+    AND, OR,            // Replace the top two by the result
+    BINARY,             // u8 operator id: an operator that is not a binary one
+    CHAIN,              // u8 operator id, u32 count: replace the top count values by the result
+    FAIL,               // u32 constant index: stop with the constant as the result
+    RETURN              // Stop with the top as the result
+};
+
+constexpr size_t opcodeCount = static_cast<size_t>(Opcode::RETURN) + 1;
+
+
+/**
+ * @brief Key of a constant, equal literals share one slot under it.
+ * @note Floats are keyed by their exact bits, so 0.0 and -0.0 stay apart.
+**/
+std::string constantKey(const Value& value);
+
+
+/**
+ * @brief Bytecode of one statement with the constants it pushes.
+ * @note Operands are stored unaligned in little-endian order right after
+ *       their opcode, so the code is a compact byte string.
+**/
+class Chunk {
+private:
+    std::vector<uint8_t> code;
+    std::vector<Value> constants;
+    size_t stackSize = 0;       // Most values on the stack at once
+
+public:
+    Chunk() = default;
+
+    const std::vector<uint8_t>& getCode() const { return code; }
+    const std::vector<Value>& getConstants() const { return constants; }
+    size_t getStackSize() const { return stackSize; }
+    bool empty() const { return code.empty(); }
+
+    void emit(Opcode op) { code.push_back(static_cast<uint8_t>(op)); }
+    void emitByte(uint8_t value) { code.push_back(value); }
+    void emitWord(uint32_t value) {
+        for (int shift = 0; shift < 32; shift += 8) code.push_back(static_cast<uint8_t>(value >> shift));
+    }
+    uint32_t addConstant(Value value) {
+        constants.push_back(std::move(value));
+        return static_cast<uint32_t>(constants.size() - 1);
+    }
+    void reserveStack(size_t size) { if (size > stackSize) stackSize = size; }
+
+    /**
+     * @brief One line per instruction, e.g. "0005 LOAD 3 ; x".
+    **/
+    std::string disassemble() const;
+    size_t instructionCount() const;
+
+    static const char* name(Opcode op);
+};
+
+
+/**
+ * @brief Base of the compilers, visiting a pointer tree in the order Interpreter evaluates it.
+ * @note An explicit work stack replaces recursion, so deep trees do not grow
+ *       the C++ stack. Every operator node is visited twice, first to
+ *       schedule its operands and then, once they are compiled, to combine them.
+**/
+class TreeCompiler : public ASTVisitor {
+protected:
+    static constexpr uint32_t noSlot = UINT32_MAX;
+
+    struct Task {
+        ASTNode* node;
+        uint32_t depth;
+        bool combine;
+        uint32_t slot = noSlot;     // Word a compiler may attach to a combine step
+    };
+
+    std::vector<Task> tasks;
+    Task task{};
+    size_t deepest = 0;         // Depth of the deepest node visited, the root is at 1
+    size_t maxDepth = Interpreter::defaultMaxDepth;
+
+    /**
+     * @brief Visit every node from the root, or stop at the first deeper than the limit.
+     * @return False when the walk stopped, after visiting what the interpreter evaluates first.
+    **/
+    bool walk(ASTNode& root, size_t limit);
+
+    // Schedule the operands of a node on its first visit, true when they were
+    bool schedule(UnaryOpNode& node);
+    bool schedule(BinaryOpNode& node);
+    bool schedule(NaryOpNode& node);
+
+    // Variable an assignment writes, nullptr for any other node
+    static IdNode* assignTarget(BinaryOpNode& node);
+
+public:
+    // Same limit as Interpreter::setMaxDepth
+    void setMaxDepth(size_t depth) { maxDepth = depth; }
+    size_t getMaxDepth() const { return maxDepth; }
+};
+
+
+/**
+ * @brief Compiler from pointer trees to bytecode.
+ * @note A subtree deeper than the maximum depth compiles to a FAIL at the
+ *       point the interpreter would give up, after the work it does first.
+**/
+class Compiler : public TreeCompiler {
+private:
+    Chunk chunk;
+    size_t depth = 0;           // Values on the stack after the code so far
+    std::unordered_map<std::string, uint32_t> pool;    // Constant index by type and value
+
+    uint32_t constant(const Value& value);
+    void push(uint32_t index);
+    void pop(size_t count);
+
+public:
+    Compiler() = default;
+
+    /**
+     * @brief Compile a tree, the code returns the value Interpreter::evaluate gives.
+    **/
+    Chunk compile(ASTNode& root);
+
+    void visit(UnaryOpNode& node) override;
+    void visit(BinaryOpNode& node) override;
+    void visit(NaryOpNode& node) override;
+    void visit(IdNode& node) override;
+    void visit(IntNode& node) override;
+    void visit(FloatNode& node) override;
+    void visit(StringNode& node) override;
+    void visit(ErrorNode& node) override;
+};
+
+
+/**
+ * @brief Stack machine running compiled chunks.
+ * @note Dispatch is threaded through computed gotos on GCC and Clang, and a
+ *       switch elsewhere or when DEMOLANG_SWITCH_DISPATCH is defined. Variables
+ *       live in the machine's own environment.
+**/
+class VM : public Singleton<VM> {
+    friend class Singleton<VM>;
+
+private:
+    Environment env = Environment();
+    std::vector<Value> stack;
+    std::vector<Value> chain;   // Operands of a CHAIN instruction
+
+public:
+    VM() = default;
+
+    Value run(const Chunk& chunk);
+    std::string interpret(const Chunk& chunk);
+
+    /**
+     * @brief Compile a tree and run it.
+     * @return The same text Interpreter::interpret gives for the tree.
+    **/
+    std::string interpret(const std::shared_ptr<ASTNode>& node);
+
+    static bool threaded();
+};
+
+} // namespace VMSpace
+
+} // namespace DemoLang
+
+#endif // DEMOLANG_VM
@@ -6,8 +6,14 @@
 #include "lexer.hpp"
 #include "parser.hpp"
 #include "interpreter.hpp"
+#include "optimizer.hpp"
+#include "closure.hpp"
+#include "regvm.hpp"
+#include "vm.hpp"
 #include <iostream>
 #include <fstream>
+#include <iterator>
+#include <vector>
 
 using namespace DemoLang;
 using namespace DemoLang::Tokens;
@@ -16,38 +22,69 @@ using namespace DemoLang::AST;
 using namespace DemoLang::ParserSpace;
 using namespace DemoLang::ValueTypes;
 using namespace DemoLang::InterpreterSpace;
+using namespace DemoLang::OptimizerSpace;
+using namespace DemoLang::VMSpace;
+
+/**
+ * @brief Evaluator running the statements, all give the same results.
+**/
+enum class Engine {
+    FLAT,       // Interpreter over one flat tree shared by the statements
+    TREE,       // Interpreter over each pointer tree
+    VM,         // Bytecode of each statement on the stack machine
+    REGISTER,   // Three-address code of each statement on the register machine
+    CLOSURE     // Closures of each statement
+};
 
 /**
  * @brief Execute a file.
  * @param filename Path to the file to execute.
+ * @param eliminateDead Skip statements the printed result does not depend on.
+ * @param engine Evaluator running the statements.
 **/
-static void executeFile(const std::string& filename) {
+static void executeFile(const std::string& filename, bool eliminateDead, Engine engine) {
     try {
         // Read file content
         std::ifstream file(filename);
         if (!file.is_open()) throw std::runtime_error("Cannot open file: " + filename);
         
-        std::string line;
+        std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
         std::string lastResult;
-        int lineNumber = 0;
         
-        Lexer& lexer = Lexer::instance();
         Parser& parser = Parser::instance();
         Interpreter& interpreter = Interpreter::instance();
+        // Parse the whole script once, then execute it statement by statement
+        Program statements = parser.parseProgram(source);
+        // Statements share one flat tree, so a subexpression repeated across
+        // the script is only computed again when a variable it reads changed
+        FlatAST program;
+        program.setMaxDepth(interpreter.getMaxDepth());
+        // Only assignments and the last value are observable, see Liveness
+        std::vector<bool> live = eliminateDead ? Liveness().analyze(statements) : std::vector<bool>(statements.size(), true);
         
-        while (std::getline(file, line)) {
-            lineNumber++;
-            // Skip empty lines
-            if (line.empty() || line.find_first_not_of(" \t\r\n") == std::string::npos) {
-                continue;
-            }
-            
+        for (size_t i = 0; i < statements.size(); i++) {
+            if (!live[i]) continue;
+            const Statement& statement = statements[i];
             try {
-                auto tokens = lexer.tokenize(line);
-                auto ast = parser.parse(tokens);
-                lastResult = interpreter.interpret(ast);
+                auto node = Optimizer::instance().optimize(statement.node);
+                if (engine == Engine::TREE) {
+                    lastResult = interpreter.interpret(node);
+                } else if (engine == Engine::VM) {
+                    lastResult = VM::instance().interpret(node);
+                } else if (engine == Engine::REGISTER) {
+                    lastResult = RegisterVM::instance().interpret(node);
+                } else if (engine == Engine::CLOSURE) {
+                    lastResult = ClosureEngine::instance().interpret(node);
+                } else {
+                    size_t index = program.statementCount();
+                    program.append(*node);
+                    lastResult = interpreter.interpret(program, index);
+                }
             } catch (const std::exception& e) {
-                std::cerr << "Error at line " << lineNumber << ": " << e.what() << std::endl;
+                std::cerr << "Error at line " << statement.line << ": " << e.what() << std::endl;
+                // Values the failed statement did not compute must not be shared
+                program = FlatAST();
+                program.setMaxDepth(interpreter.getMaxDepth());
             }
         }
         
@@ -63,15 +100,46 @@ static void executeFile(const std::string& filename) {
 /**
  * @brief Load a file and execute it.
  * @param argc Argument count.
- * @param argv Argument vector.
+ * @param argv Argument vector, options start with "--".
  */
 void load(int argc, char* argv[]) {
     if (argc == 0) {
         std::cerr << "Environment does not support!" << std::endl;
-    } else if (argc == 1) {
+        return;
+    }
+
+    std::vector<std::string> files;
+    bool eliminateDead = false;
+    Engine engine = Engine::FLAT;
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--no-fold") {
+            // Evaluate trees exactly as parsed
+            Optimizer::instance().setEnabled(false);
+        } else if (argument == "--eliminate-dead") {
+            eliminateDead = true;
+        } else if (argument == "--engine=flat") {
+            engine = Engine::FLAT;
+        } else if (argument == "--engine=tree") {
+            engine = Engine::TREE;
+        } else if (argument == "--engine=vm") {
+            engine = Engine::VM;
+        } else if (argument == "--engine=register") {
+            engine = Engine::REGISTER;
+        } else if (argument == "--engine=closure") {
+            engine = Engine::CLOSURE;
+        } else if (argument.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option: " << argument << std::endl;
+            return;
+        } else {
+            files.push_back(argument);
+        }
+    }
+
+    if (files.empty()) {
         std::cerr << "No file specified!" << std::endl;
-    } else if (argc == 2) {
-        executeFile(argv[1]);
+    } else if (files.size() == 1) {
+        executeFile(files[0], eliminateDead, engine);
     } else {
         std::cerr << "Too many arguments!" << std::endl;
     }
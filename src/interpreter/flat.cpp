@@ -0,0 +1,183 @@
+/**
+ * @file src/interpreter/flat.cpp
+ * @brief Evaluator for flat trees.
+**/
+
+#include "interpreter.hpp"
+
+
+namespace DemoLang {
+
+static_assert(FlatAST::defaultMaxDepth == InterpreterSpace::Interpreter::defaultMaxDepth,
+              "Flat trees stop at the depth the pointer tree evaluation does");
+
+void InterpreterSpace::Interpreter::run(const FlatAST& tree, uint32_t begin, uint32_t end) {
+    // Nodes are in post-order, so every operand has a value before it is used
+    const std::vector<FlatNode>& nodes = tree.getNodes();
+    for (uint32_t i = begin; i < end; i++) {
+        if (isNumeric(tree.type(i)) && compute(tree, i)) continue;
+
+        const FlatNode& node = nodes[i];
+        switch (node.op) {
+            case OpCode::INT:
+                values[i] = Value::makeInteger(tree.integer(node.a));
+                break;
+            case OpCode::FLOAT:
+                values[i] = Value::makeFloat(tree.floating(node.a));
+                break;
+            case OpCode::STRING:
+                values[i] = Value::makeString(tree.string(node.a));
+                break;
+            case OpCode::ERROR:
+                values[i] = Value::makeException(tree.string(node.a));
+                break;
+            case OpCode::LOAD:
+                values[i] = env.has(node.a) ? env.get(node.a)
+                    : Value::makeException("Undefined variable: " + SymbolTable::instance().name(node.a));
+                break;
+            case OpCode::NEG:
+            case OpCode::NOT:
+            case OpCode::INVALID_UNARY:
+                values[i] = UnaryOperatorFactory::execute(toOperator(node.op), values[node.a]);
+                break;
+            case OpCode::ASSIGN:
+                // Assignment expression returns the assigned value
+                env.set(node.a, values[node.b]);
+                values[i] = values[node.b];
+                break;
+            case OpCode::INVALID_ASSIGN:
+                values[i] = Value::makeException("Left side of assignment must be an identifier");
+                break;
+            case OpCode::SUM:
+            case OpCode::PRODUCT: {
+                const uint32_t* operands = tree.operands(node);
+                chain.clear();
+                for (uint32_t k = 0; k < node.b; k++) chain.push_back(values[operands[k]]);
+                values[i] = BinOperatorFactory::executeChain(toOperator(node.op), chain);
+                break;
+            }
+            default:
+                values[i] = BinOperatorFactory::execute(toOperator(node.op), values[node.a], values[node.b]);
+                break;
+        }
+    }
+}
+
+
+bool InterpreterSpace::Interpreter::compute(const FlatAST& tree, uint32_t index) {
+    // Same arithmetic as the operator factories, Integers only mix with Floats as long double
+    const FlatNode& node = tree.getNodes()[index];
+    auto integer = [&](uint32_t k) { return values[k].getInteger(); };
+    auto real = [&](uint32_t k) { return values[k].toFloat(); };
+    auto numeric = [&]() { return isNumeric(tree.type(node.a)) && isNumeric(tree.type(node.b)); };
+    bool integral = tree.type(index) == StaticType::INTEGER;
+    Value& out = values[index];
+
+    switch (node.op) {
+        case OpCode::INT:   out = Value::makeInteger(tree.integer(node.a)); break;
+        case OpCode::FLOAT: out = Value::makeFloat(tree.floating(node.a)); break;
+        case OpCode::NEG:
+            out = integral ? Value::makeInteger(-integer(node.a)) : Value::makeFloat(-values[node.a].getFloat());
+            break;
+        case OpCode::NOT:   out = Value::makeInteger(real(node.a) == 0.0 ? 1 : 0); break;
+        case OpCode::ADD:
+            out = integral ? Value::makeInteger(integer(node.a) + integer(node.b)) : Value::makeFloat(real(node.a) + real(node.b));
+            break;
+        case OpCode::SUB:
+            out = integral ? Value::makeInteger(integer(node.a) - integer(node.b)) : Value::makeFloat(real(node.a) - real(node.b));
+            break;
+        case OpCode::MUL:
+            out = integral ? Value::makeInteger(integer(node.a) * integer(node.b)) : Value::makeFloat(real(node.a) * real(node.b));
+            break;
+        case OpCode::DIV:   out = Value::makeFloat(real(node.a) / real(node.b)); break;
+        case OpCode::EQ:
+        case OpCode::NE:
+        case OpCode::LT:
+        case OpCode::LE:
+        case OpCode::GT:
+        case OpCode::GE: {
+            // Strings compare on the generic path
+            if (!numeric()) return false;
+            long double left = real(node.a), right = real(node.b);
+            bool holds = false;
+            switch (node.op) {
+                case OpCode::EQ: holds = left == right; break;
+                case OpCode::NE: holds = left != right; break;
+                case OpCode::LT: holds = left < right; break;
+                case OpCode::LE: holds = left <= right; break;
+                case OpCode::GT: holds = left > right; break;
+                default:         holds = left >= right; break;
+            }
+            out = Value::makeInteger(holds ? 1 : 0);
+            break;
+        }
+        case OpCode::AND:
+        case OpCode::OR: {
+            if (!numeric()) return false;
+            bool left = real(node.a) != 0.0, right = real(node.b) != 0.0;
+            out = Value::makeInteger((node.op == OpCode::AND ? left && right : left || right) ? 1 : 0);
+            break;
+        }
+        case OpCode::SUM:
+        case OpCode::PRODUCT: {
+            const uint32_t* operands = tree.operands(node);
+            bool sum = node.op == OpCode::SUM;
+            // Integers before the first Float are accumulated exactly, as executeChain does
+            uint32_t k = 1;
+            long double total = real(operands[0]);
+            if (tree.type(operands[0]) == StaticType::INTEGER) {
+                long long prefix = integer(operands[0]);
+                for (; k < node.b && tree.type(operands[k]) == StaticType::INTEGER; k++) {
+                    prefix = sum ? prefix + integer(operands[k]) : prefix * integer(operands[k]);
+                }
+                if (integral) {
+                    out = Value::makeInteger(prefix);
+                    break;
+                }
+                total = static_cast<long double>(prefix);
+            }
+            for (; k < node.b; k++) total = sum ? total + real(operands[k]) : total * real(operands[k]);
+            out = Value::makeFloat(total);
+            break;
+        }
+        default:
+            // Loads and assignments only copy a value, the generic path does that as well
+            return false;
+    }
+    return true;
+}
+
+
+Value InterpreterSpace::Interpreter::evaluate(const FlatAST& tree) {
+    if (tree.empty()) return Value::makeException("Null AST Node");
+
+    values.assign(tree.size(), Value());
+    run(tree, 0, static_cast<uint32_t>(tree.size()));
+    result = values[tree.root()];
+    values.clear();
+    return result;
+}
+
+
+Value InterpreterSpace::Interpreter::evaluate(const FlatAST& tree, size_t statement) {
+    if (statement >= tree.statementCount()) return Value::makeException("Null AST Node");
+
+    if (statement == 0) values.assign(tree.size(), Value());
+    // The tree may have grown since the previous statement was evaluated
+    values.resize(tree.size());
+    run(tree, tree.statementBegin(statement), tree.statementEnd(statement));
+    result = values[tree.getRoots()[statement]];
+    return result;
+}
+
+
+std::string InterpreterSpace::Interpreter::interpret(const FlatAST& tree) {
+    return render(evaluate(tree));
+}
+
+
+std::string InterpreterSpace::Interpreter::interpret(const FlatAST& tree, size_t statement) {
+    return render(evaluate(tree, statement));
+}
+
+} // namespace DemoLang
@@ -8,53 +8,73 @@
 
 namespace DemoLang {
 
-bool InterpreterSpace::Environment::has(const std::string& name) const {
+bool InterpreterSpace::Environment::has(uint32_t symbol) const {
     // Check if variable exists in current scope
-    return scope.find(name) != scope.end();
+    return symbol < scope.size() && !scope[symbol].isNone();
 }
 
 
-std::shared_ptr<BaseType> InterpreterSpace::Environment::get(const std::string& name) const {
+Value InterpreterSpace::Environment::get(uint32_t symbol) const {
     // Retrieve variable value from scope
-    auto it = scope.find(name);
-    if (it != scope.end()) return it->second;
+    if (has(symbol)) return scope[symbol];
     // Return exception if variable not found
-    return std::make_shared<Exception>("Cannot find variable: " + name);
+    return Value::makeException("Cannot find variable: " + SymbolTable::instance().name(symbol));
 }
 
 
-void InterpreterSpace::Environment::set(const std::string& name, const BaseType& value) {
-    // Store variable in scope with cloned value
-    scope[name] = value.clone();
+void InterpreterSpace::Environment::set(uint32_t symbol, const Value& value) {
+    // Store variable in scope, growing to cover the id. Text is immutable, so the copy may share it
+    if (symbol >= scope.size()) scope.resize(symbol + 1);
+    scope[symbol] = value;
 }
 
 
 std::string InterpreterSpace::Interpreter::interpret(const std::shared_ptr<AST::ASTNode>& node) {
     // Handle null AST node
-    if (!node) {
-        auto result = std::make_shared<Exception>("Null AST Node");
-        return std::any_cast<std::string>(result->getValue());
-    }
+    if (!node) return render(Value::makeException("Null AST Node"));
+
+    return render(evaluate(*node));
+}
 
-    // Start AST traversal using visitor pattern
-    node->accept(*this);
 
-    // Handle interpretation result
-    if (!result) {
-        result = std::make_shared<Exception>("Failed to interpret");
+Value InterpreterSpace::Interpreter::evaluate(ASTNode& root) {
+    tasks.assign(1, Task{&root, 1, false});
+    operands.clear();
+
+    // Visitors push operand tasks or combine operands, leaves leave their value in result
+    while (!tasks.empty()) {
+        task = tasks.back();
+        tasks.pop_back();
+        if (task.depth > maxDepth) {
+            tasks.clear();
+            operands.clear();
+            return Value::makeException("Maximum evaluation depth exceeded");
+        }
+        result = Value();
+        task.node->accept(*this);
+        if (!result.isNone()) operands.push_back(std::move(result));
     }
-    
+    result = std::move(operands.back());
+    operands.clear();
+    return result;
+}
+
+
+Value InterpreterSpace::Interpreter::pop() {
+    Value value = std::move(operands.back());
+    operands.pop_back();
+    return value;
+}
+
+
+std::string InterpreterSpace::Interpreter::render(const Value& value) {
     // Convert result to string representation based on type
-    if (auto exc = dynamic_cast<Exception*>(result.get())) {
-        return std::any_cast<std::string>(exc->getValue());
-    } else if (auto str = dynamic_cast<String*>(result.get())) {
-        return std::any_cast<std::string>(str->getValue());
-    } else if (auto integer = dynamic_cast<Integer*>(result.get())) {
-        return std::to_string(std::any_cast<long long>(integer->getValue()));
-    } else if (auto flo = dynamic_cast<Float*>(result.get())) {
-        return std::to_string(std::any_cast<long double>(flo->getValue()));
-    } else {
-        return "Unknown type";
+    switch (value.getType()) {
+        case Value::Type::EXCEPTION:
+        case Value::Type::STRING:   return value.getString();
+        case Value::Type::INTEGER:  return std::to_string(value.getInteger());
+        case Value::Type::FLOAT:    return std::to_string(value.getFloat());
+        default:                    return "Failed to interpret";
     }
 }
 
@@ -4,286 +4,237 @@
 **/
 
 #include "interpreter.hpp"
+#include <utility>
 
 
 namespace DemoLang {
 
-// binary operator factory
-class BinOperatorFactory {
-private:
-    static std::unordered_map<std::string, std::function<std::shared_ptr<BaseType>(std::shared_ptr<BaseType>, std::shared_ptr<BaseType>)>> operators;
-    
-    // Helper functions
-    static bool isNumeric(std::shared_ptr<BaseType> operand);
-    static std::shared_ptr<BaseType> toFloat(std::shared_ptr<BaseType> operand);
-    static std::shared_ptr<BaseType> toInt(std::shared_ptr<BaseType> operand);
-    static bool toBool(std::shared_ptr<BaseType> operand);
-    
-public:
-    static void initialize();
-    static std::shared_ptr<BaseType> execute(const std::string& op, std::shared_ptr<BaseType> left, std::shared_ptr<BaseType> right);
-};
+namespace {
 
-// Static operator map
-std::unordered_map<std::string, std::function<std::shared_ptr<BaseType>(std::shared_ptr<BaseType>, std::shared_ptr<BaseType>)>> 
-    BinOperatorFactory::operators;
+using Type = Value::Type;
+using Kernel = InterpreterSpace::BinOperatorFactory::Kernel;
 
-// Helper functions
-bool BinOperatorFactory::isNumeric(std::shared_ptr<BaseType> operand) {
-    return operand->getName() == "Integer" || operand->getName() == "Float";
+constexpr bool isNumeric(Type type) { return type == Type::INTEGER || type == Type::FLOAT; }
+
+constexpr bool isArithmetic(Operator op) {
+    return op == Operator::PLUS || op == Operator::MINUS || op == Operator::MULTIPLY || op == Operator::DIVIDE;
 }
 
-std::shared_ptr<BaseType> BinOperatorFactory::toInt(std::shared_ptr<BaseType> operand) {
-    if (!operand) return std::make_shared<Exception>("Null operand");
-    
-    if (operand->getName() == "Integer") return operand;
-    if (operand->getName() == "Float") {
-        return std::make_shared<Integer>(static_cast<long long>(std::any_cast<long double>(operand->getValue())));
-    }
-    return std::make_shared<Exception>("Type conversion error");
+constexpr bool isComparison(Operator op) {
+    return op == Operator::EQUAL || op == Operator::NOT_EQUAL || op == Operator::LESS
+        || op == Operator::LESS_EQUAL || op == Operator::GREATER || op == Operator::GREATER_EQUAL;
 }
 
-std::shared_ptr<BaseType> BinOperatorFactory::toFloat(std::shared_ptr<BaseType> operand) {
-    if (!operand) return std::make_shared<Exception>("Null operand");
-    
-    if (operand->getName() == "Float") return operand;
-    if (operand->getName() == "Integer") {
-        return std::make_shared<Float>(static_cast<long double>(std::any_cast<long long>(operand->getValue())));
-    }
-    return std::make_shared<Exception>("Type conversion error");
+// Float value of a numeric operand of a known type, Integers are promoted
+template <Type type>
+long double real(const Value& operand) {
+    if constexpr (type == Type::INTEGER) return static_cast<long double>(operand.getInteger());
+    else return operand.getFloat();
 }
 
-bool BinOperatorFactory::toBool(std::shared_ptr<BaseType> operand) {
-    if (isNumeric(operand)) {
-        auto val = toFloat(operand);
-        return std::any_cast<long double>(val->getValue()) != 0.0;
-    }
-    if (operand->getName() == "String") {
-        return !std::any_cast<std::string>(operand->getValue()).empty();
+// Truth of an operand of a known type: non-zero numbers and non-empty strings
+template <Type type>
+bool truth(const Value& operand) {
+    if constexpr (isNumeric(type)) return real<type>(operand) != 0.0;
+    else if constexpr (type == Type::STRING) return !operand.getString().empty();
+    else return false;
+}
+
+// An operator applied to operands of fixed types, every type check is decided at compile time
+template <Operator op, Type leftType, Type rightType>
+Value kernel(const Value& left, const Value& right) {
+    constexpr bool numbers = isNumeric(leftType) && isNumeric(rightType);
+    constexpr bool integers = leftType == Type::INTEGER && rightType == Type::INTEGER;
+    constexpr bool strings = leftType == Type::STRING && rightType == Type::STRING;
+
+    // Logical operators accept any operands
+    if constexpr (op == Operator::AND) {
+        return Value::makeInteger(truth<leftType>(left) && truth<rightType>(right) ? 1 : 0);
+    } else if constexpr (op == Operator::OR) {
+        return Value::makeInteger(truth<leftType>(left) || truth<rightType>(right) ? 1 : 0);
+    } else if constexpr (!isArithmetic(op) && !isComparison(op)) {
+        return Value::makeException("Unsupported operator");
+    // Strings join and compare for equality
+    } else if constexpr (strings && op == Operator::PLUS) {
+        return Value::makeString(left.getString() + right.getString());
+    } else if constexpr (strings && op == Operator::EQUAL) {
+        return Value::makeInteger(left.getString() == right.getString() ? 1 : 0);
+    } else if constexpr (strings && op == Operator::NOT_EQUAL) {
+        return Value::makeInteger(left.getString() != right.getString() ? 1 : 0);
+    } else if constexpr (!numbers) {
+        return Value::makeException("Type error");
+    // Arithmetic returns Integer if both operands are Integer, otherwise Float
+    } else if constexpr (op == Operator::PLUS) {
+        if constexpr (integers) return Value::makeInteger(left.getInteger() + right.getInteger());
+        else return Value::makeFloat(real<leftType>(left) + real<rightType>(right));
+    } else if constexpr (op == Operator::MINUS) {
+        if constexpr (integers) return Value::makeInteger(left.getInteger() - right.getInteger());
+        else return Value::makeFloat(real<leftType>(left) - real<rightType>(right));
+    } else if constexpr (op == Operator::MULTIPLY) {
+        if constexpr (integers) return Value::makeInteger(left.getInteger() * right.getInteger());
+        else return Value::makeFloat(real<leftType>(left) * real<rightType>(right));
+    } else if constexpr (op == Operator::DIVIDE) {
+        long double divisor = real<rightType>(right);
+        if (divisor == 0.0) return Value::makeException("Division by zero");
+        return Value::makeFloat(real<leftType>(left) / divisor);
+    // Numbers always compare as Floats
+    } else if constexpr (op == Operator::EQUAL) {
+        return Value::makeInteger(real<leftType>(left) == real<rightType>(right) ? 1 : 0);
+    } else if constexpr (op == Operator::NOT_EQUAL) {
+        return Value::makeInteger(real<leftType>(left) != real<rightType>(right) ? 1 : 0);
+    } else if constexpr (op == Operator::LESS) {
+        return Value::makeInteger(real<leftType>(left) < real<rightType>(right) ? 1 : 0);
+    } else if constexpr (op == Operator::LESS_EQUAL) {
+        return Value::makeInteger(real<leftType>(left) <= real<rightType>(right) ? 1 : 0);
+    } else if constexpr (op == Operator::GREATER) {
+        return Value::makeInteger(real<leftType>(left) > real<rightType>(right) ? 1 : 0);
+    } else {
+        return Value::makeInteger(real<leftType>(left) >= real<rightType>(right) ? 1 : 0);
     }
-    return false;
 }
 
-// Initialize all operators
-void BinOperatorFactory::initialize() {
-    if (!operators.empty()) return;
-    
-    // Arithmetic operators
-    operators["+"] = [](auto left, auto right) -> std::shared_ptr<BaseType> {
-        if (left->getName() == "String" && right->getName() == "String") {
-            return std::make_shared<String>(
-                std::any_cast<std::string>(left->getValue()) + 
-                std::any_cast<std::string>(right->getValue())
-            );
-        }
-        if (!isNumeric(left) || !isNumeric(right)) return std::make_shared<Exception>("Type error");
-        
-        // Return Integer if both operands are Integer, otherwise Float
-        if (left->getName() == "Integer" && right->getName() == "Integer") {
-            auto lVal = std::any_cast<long long>(left->getValue());
-            auto rVal = std::any_cast<long long>(right->getValue());
-            return std::make_shared<Integer>(lVal + rVal);
-        } else {
-            auto l = toFloat(left), r = toFloat(right);
-            return std::make_shared<Float>(
-                std::any_cast<long double>(l->getValue()) + 
-                std::any_cast<long double>(r->getValue())
-            );
-        }
-    };
-    
-    operators["-"] = [](auto left, auto right) -> std::shared_ptr<BaseType> {
-        if (!isNumeric(left) || !isNumeric(right)) return std::make_shared<Exception>("Type error");
-        
-        // Return Integer if both operands are Integer, otherwise Float
-        if (left->getName() == "Integer" && right->getName() == "Integer") {
-            auto lVal = std::any_cast<long long>(left->getValue());
-            auto rVal = std::any_cast<long long>(right->getValue());
-            return std::make_shared<Integer>(lVal - rVal);
-        } else {
-            auto l = toFloat(left), r = toFloat(right);
-            return std::make_shared<Float>(
-                std::any_cast<long double>(l->getValue()) - 
-                std::any_cast<long double>(r->getValue())
-            );
-        }
-    };
-    
-    operators["*"] = [](auto left, auto right) -> std::shared_ptr<BaseType> {
-        if (!isNumeric(left) || !isNumeric(right)) return std::make_shared<Exception>("Type error");
-        
-        // Return Integer if both operands are Integer, otherwise Float
-        if (left->getName() == "Integer" && right->getName() == "Integer") {
-            auto lVal = std::any_cast<long long>(left->getValue());
-            auto rVal = std::any_cast<long long>(right->getValue());
-            return std::make_shared<Integer>(lVal * rVal);
-        } else {
-            auto l = toFloat(left), r = toFloat(right);
-            return std::make_shared<Float>(
-                std::any_cast<long double>(l->getValue()) * 
-                std::any_cast<long double>(r->getValue())
-            );
-        }
-    };
-    
-    operators["/"] = [](auto left, auto right) -> std::shared_ptr<BaseType> {
-        if (!isNumeric(left) || !isNumeric(right)) return std::make_shared<Exception>("Type error");
-        auto r = toFloat(right);
-        auto rVal = std::any_cast<long double>(r->getValue());
-        if (rVal == 0.0) return std::make_shared<Exception>("Division by zero");
-        
-        auto l = toFloat(left);
-        return std::make_shared<Float>(
-            std::any_cast<long double>(l->getValue()) / rVal
-        );
-    };
-    
-    // Comparison operators
-    operators["=="] = [](auto left, auto right) -> std::shared_ptr<BaseType> {
-        if (left->getName() == "String" && right->getName() == "String") {
-            return std::make_shared<Integer>(
-                std::any_cast<std::string>(left->getValue()) == 
-                std::any_cast<std::string>(right->getValue()) ? 1 : 0
-            );
-        }
-        if (!isNumeric(left) || !isNumeric(right)) return std::make_shared<Exception>("Type error");
-        auto l = toFloat(left), r = toFloat(right);
-        return std::make_shared<Integer>(
-            std::any_cast<long double>(l->getValue()) == 
-            std::any_cast<long double>(r->getValue()) ? 1 : 0
-        );
-    };
-    
-    operators["!="] = [](auto left, auto right) -> std::shared_ptr<BaseType> {
-        if (left->getName() == "String" && right->getName() == "String") {
-            return std::make_shared<Integer>(
-                std::any_cast<std::string>(left->getValue()) != 
-                std::any_cast<std::string>(right->getValue()) ? 1 : 0
-            );
-        }
-        if (!isNumeric(left) || !isNumeric(right)) return std::make_shared<Exception>("Type error");
-        auto l = toFloat(left), r = toFloat(right);
-        return std::make_shared<Integer>(
-            std::any_cast<long double>(l->getValue()) != 
-            std::any_cast<long double>(r->getValue()) ? 1 : 0
-        );
-    };
-    
-    operators[">"] = [](auto left, auto right) -> std::shared_ptr<BaseType> {
-        if (!isNumeric(left) || !isNumeric(right)) return std::make_shared<Exception>("Type error");
-        auto l = toFloat(left), r = toFloat(right);
-        return std::make_shared<Integer>(
-            std::any_cast<long double>(l->getValue()) > 
-            std::any_cast<long double>(r->getValue()) ? 1 : 0
-        );
-    };
-    
-    operators["<"] = [](auto left, auto right) -> std::shared_ptr<BaseType> {
-        if (!isNumeric(left) || !isNumeric(right)) return std::make_shared<Exception>("Type error");
-        auto l = toFloat(left), r = toFloat(right);
-        return std::make_shared<Integer>(
-            std::any_cast<long double>(l->getValue()) < 
-            std::any_cast<long double>(r->getValue()) ? 1 : 0
-        );
-    };
-    
-    operators[">="] = [](auto left, auto right) -> std::shared_ptr<BaseType> {
-        if (!isNumeric(left) || !isNumeric(right)) return std::make_shared<Exception>("Type error");
-        auto l = toFloat(left), r = toFloat(right);
-        return std::make_shared<Integer>(
-            std::any_cast<long double>(l->getValue()) >= 
-            std::any_cast<long double>(r->getValue()) ? 1 : 0
-        );
-    };
-    
-    operators["<="] = [](auto left, auto right) -> std::shared_ptr<BaseType> {
-        if (!isNumeric(left) || !isNumeric(right)) return std::make_shared<Exception>("Type error");
-        auto l = toFloat(left), r = toFloat(right);
-        return std::make_shared<Integer>(
-            std::any_cast<long double>(l->getValue()) <= 
-            std::any_cast<long double>(r->getValue()) ? 1 : 0
-        );
-    };
-    
-    // Logical operators
-    operators["&"] = [](auto left, auto right) -> std::shared_ptr<BaseType> {
-        return std::make_shared<Integer>(toBool(left) && toBool(right) ? 1 : 0);
-    };
-    
-    operators["|"] = [](auto left, auto right) -> std::shared_ptr<BaseType> {
-        return std::make_shared<Integer>(toBool(left) || toBool(right) ? 1 : 0);
-    };
+constexpr size_t typeCount = Value::typeCount;
+
+constexpr size_t slot(Operator op, Type left, Type right) {
+    return (static_cast<size_t>(op) * typeCount + static_cast<size_t>(left)) * typeCount + static_cast<size_t>(right);
+}
+
+template <size_t... Slots>
+constexpr std::array<Kernel, sizeof...(Slots)> makeKernels(std::index_sequence<Slots...>) {
+    return {&kernel<static_cast<Operator>(Slots / (typeCount * typeCount)),
+                    static_cast<Type>(Slots / typeCount % typeCount),
+                    static_cast<Type>(Slots % typeCount)>...};
 }
 
-// Execute operator
-std::shared_ptr<BaseType> BinOperatorFactory::execute(
-    const std::string& op, 
-    std::shared_ptr<BaseType> left, 
-    std::shared_ptr<BaseType> right
+// Every operator including NONE, by every pair of operand types
+constexpr std::array<Kernel, (operatorCount + 1) * typeCount * typeCount> kernels =
+    makeKernels(std::make_index_sequence<(operatorCount + 1) * typeCount * typeCount>());
+
+} // namespace
+
+
+InterpreterSpace::BinOperatorFactory::Kernel InterpreterSpace::BinOperatorFactory::kernel(
+    Operator op,
+    Value::Type left,
+    Value::Type right
 ) {
-    initialize();
-    auto it = operators.find(op);
-    if (it != operators.end()) {
-        return it->second(left, right);
+    return kernels[slot(op, left, right)];
+}
+
+
+// Execute operator over a chain
+Value InterpreterSpace::BinOperatorFactory::executeChain(Operator op, const Value* operands, size_t count) {
+    if (count == 0) return Value::makeException("Null operand");
+    if (count == 1) return operands[0];
+    if (op != Operator::PLUS && op != Operator::MULTIPLY) {
+        // No shortcut for other operators, apply them pair by pair
+        Value result = operands[0];
+        for (size_t i = 1; i < count; i++) result = execute(op, result, operands[i]);
+        return result;
+    }
+
+    // Once a pair fails, every later pair fails the same way
+    if (operands[0].isString()) {
+        if (op != Operator::PLUS) return Value::makeException("Type error");
+        // Strings only join with strings, measured first so the result is allocated once
+        size_t length = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (!operands[i].isString()) return Value::makeException("Type error");
+            length += operands[i].getString().size();
+        }
+        std::string joined;
+        joined.reserve(length);
+        for (size_t i = 0; i < count; i++) joined += operands[i].getString();
+        return Value::makeString(std::move(joined));
+    }
+    if (!operands[0].isNumeric()) return Value::makeException("Type error");
+
+    // Integers stay Integer until the first Float, which promotes the rest of the chain
+    size_t i = 1;
+    long double real;
+    if (operands[0].isInteger()) {
+        long long integer = operands[0].getInteger();
+        for (; i < count && operands[i].isInteger(); i++) {
+            integer = op == Operator::PLUS ? integer + operands[i].getInteger() : integer * operands[i].getInteger();
+        }
+        if (i == count) return Value::makeInteger(integer);
+        real = static_cast<long double>(integer);
+    } else {
+        real = operands[0].getFloat();
+    }
+    for (; i < count; i++) {
+        if (!operands[i].isNumeric()) return Value::makeException("Type error");
+        real = op == Operator::PLUS ? real + operands[i].toFloat() : real * operands[i].toFloat();
     }
-    return std::make_shared<Exception>("Unsupported operator");
+    return Value::makeFloat(real);
 }
 
-// Original visitor implementations
-void InterpreterSpace::Interpreter::visit(UnaryOpNode& node) {
-    // First evaluate the operand
-    node.getOperand()->accept(*this);
-    std::shared_ptr<BaseType> operand = result;
 
+Value InterpreterSpace::UnaryOperatorFactory::execute(Operator op, const Value& operand) {
     // Type validation: unary operators only work on numeric types
-    if (operand->getName() != "Integer" && operand->getName() != "Float") {
-        result = std::make_shared<Exception>("Operand must be numeric");
-        return;
-    }
+    if (!operand.isNumeric()) return Value::makeException("Operand must be numeric");
 
     // Handle different unary operators
-    if (node.getOp() == "-") {
+    if (op == Operator::MINUS) {
         // Unary minus: negate the numeric value
-        if (operand->getName() == "Integer") {
-            result = std::make_shared<Integer>(-std::any_cast<long long>(operand->getValue()));
-        } else if (operand->getName() == "Float") {
-            result = std::make_shared<Float>(-std::any_cast<long double>(operand->getValue()));
-        }
-    } else if (node.getOp() == "!") {
+        if (operand.isInteger()) return Value::makeInteger(-operand.getInteger());
+        return Value::makeFloat(-operand.getFloat());
+    } else if (op == Operator::NOT) {
         // Logical NOT: convert to boolean (0 = false, non-zero = true), then invert
-        if (operand->getName() == "Integer") {
-            result = std::make_shared<Integer>(std::any_cast<long long>(operand->getValue()) == 0 ? 1 : 0);
-        } else if (operand->getName() == "Float") {
-            result = std::make_shared<Integer>(std::any_cast<long double>(operand->getValue()) == 0.0 ? 1 : 0);
-        }
-    } else {
-        result = std::make_shared<Exception>("Unsupported operator");
+        if (operand.isInteger()) return Value::makeInteger(operand.getInteger() == 0 ? 1 : 0);
+        return Value::makeInteger(operand.getFloat() == 0.0 ? 1 : 0);
     }
+    return Value::makeException("Unsupported operator");
 }
 
+// Visitor implementations, operands are scheduled first and combined on the second visit
+void InterpreterSpace::Interpreter::visit(UnaryOpNode& node) {
+    if (!task.combine) {
+        // First evaluate the operand
+        tasks.push_back({&node, task.depth, true});
+        tasks.push_back({node.getOperand(), task.depth + 1, false});
+        return;
+    }
+    result = UnaryOperatorFactory::execute(operatorOf(node.getOp()), pop());
+}
 
 void InterpreterSpace::Interpreter::visit(BinaryOpNode& node) {
-    // Evaluate left operand first
-    node.getLeft()->accept(*this);
-    std::shared_ptr<BaseType> left = result;
-    // Then evaluate right operand
-    node.getRight()->accept(*this);
-    std::shared_ptr<BaseType> right = result;
+    if (!task.combine) {
+        // Evaluate left operand first, then right operand
+        tasks.push_back({&node, task.depth, true});
+        tasks.push_back({node.getRight(), task.depth + 1, false});
+        tasks.push_back({node.getLeft(), task.depth + 1, false});
+        return;
+    }
+    Value right = pop();
+    Value left = pop();
     
     // Handle assignment operator separately (special case with side effects)
-    if (node.getOp() == "=") {
+    Operator op = operatorOf(node.getOp());
+    if (op == Operator::ASSIGN) {
         if (auto* identifier = dynamic_cast<IdNode*>(node.getLeft())) {
-            std::string name = identifier->getName();
-            env.set(name, *right); // Store value in environment
-            result = right; // Assignment expression returns the assigned value
+            env.set(identifier->getSymbol(), right); // Store value in environment
+            result = std::move(right); // Assignment expression returns the assigned value
         } else {
-            result = std::make_shared<Exception>("Left side of assignment must be an identifier");
+            result = Value::makeException("Left side of assignment must be an identifier");
         }
         return;
     }
     
     // For all other binary operators, use the factory pattern
-    result = BinOperatorFactory::execute(node.getOp(), left, right);
+    result = BinOperatorFactory::execute(op, left, right);
+}
+
+void InterpreterSpace::Interpreter::visit(NaryOpNode& node) {
+    if (!task.combine) {
+        // Evaluate the operands from left to right
+        tasks.push_back({&node, task.depth, true});
+        for (size_t i = node.size(); i-- > 0;) tasks.push_back({node.getOperand(i), task.depth + 1, false});
+        return;
+    }
+    chain.assign(std::make_move_iterator(operands.end() - node.size()), std::make_move_iterator(operands.end()));
+    operands.resize(operands.size() - node.size());
+    result = BinOperatorFactory::executeChain(operatorOf(node.getOp()), chain);
 }
 
 } // namespace DemoLang
\ No newline at end of file
@@ -9,24 +9,24 @@
 namespace DemoLang {
 
 void InterpreterSpace::Interpreter::visit(IdNode& node) {
-    result = env.has(node.getName()) ? env.get(node.getName())
-        : std::make_shared<Exception>("Undefined variable: " + node.getName());
+    result = env.has(node.getSymbol()) ? env.get(node.getSymbol())
+        : Value::makeException("Undefined variable: " + node.getName());
 }
 
 void InterpreterSpace::Interpreter::visit(IntNode& node) {
-    result = std::make_shared<Integer>(node.getValue());
+    result = Value::makeInteger(node.getValue());
 }
 
 void InterpreterSpace::Interpreter::visit(FloatNode& node) {
-    result = std::make_shared<Float>(node.getValue());
+    result = Value::makeFloat(node.getValue());
 }
 
 void InterpreterSpace::Interpreter::visit(StringNode& node) {
-    result = std::make_shared<String>(node.getValue());
+    result = Value::makeString(node.getValue());
 }
 
 void InterpreterSpace::Interpreter::visit(ErrorNode& node) {
-    result = std::make_shared<Exception>(node.getMessage());
+    result = Value::makeException(node.getMessage());
 }
 
 } // namespace DemoLang
\ No newline at end of file
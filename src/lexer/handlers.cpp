@@ -15,27 +15,6 @@ using namespace DemoLang::LexerSpace;
 
 namespace DemoLang {
 
-/**
- * @brief Flyweight factory for tokens
- */
-class TokenFlyweight {
-private:
-    static Utils::FlyweightFactory<std::string, Token>& factory() {
-        return Utils::FlyweightFactory<std::string, Token>::instance();
-    }
-    
-public:
-    static std::shared_ptr<Token> getToken(TokenType type, const std::string& value = "") {
-        auto key = std::to_string(static_cast<int>(type)) + ":" + value;
-        return factory().getFlyweight(key, [type, &value]() {
-            return std::make_shared<Token>(type, value);
-        });
-    }
-    
-    static void clearCache() { factory().clear(); }
-    static size_t cacheSize() { return factory().size(); }
-};
-
 std::shared_ptr<Token> EOFHandler::handle() {
     // Check if we've reached end of input
     if (lexer.current() == '\0') {
@@ -48,8 +27,7 @@ std::shared_ptr<Token> EOFHandler::handle() {
 
 std::shared_ptr<Token> WhitespaceHandler::handle() {
     // Check if current character is whitespace
-    std::string str(1, lexer.current());
-    if (std::find(whitespaces.begin(), whitespaces.end(), str) != whitespaces.end()) {
+    if (TableScanner::classOf(lexer.current()) == CharClass::WHITESPACE) {
         // Skip whitespace and continue with next character
         lexer.advance();
     }
@@ -80,13 +58,11 @@ std::shared_ptr<Token> IdentifierHandler::handle() {
     char c = lexer.current();
     // Check if character starts an identifier (letter or underscore)
     if (isalpha(static_cast<unsigned char>(c)) || c == '_') {
-        std::string value;
-        // Continue collecting alphanumeric characters and underscores
-        while (isalnum(lexer.current()) || lexer.current() == '_') {
-            value += lexer.current();
-            lexer.advance();
-        }
-        return TokenFlyweight::getToken(TokenType::IDENTIFIER, value);
+        // Collect the whole run of alphanumeric characters and underscores at once
+        size_t start = lexer.pos();
+        size_t end = ScanKernels::active().identifier(lexer.getInput(), start + 1);
+        lexer.advance(end - start);
+        return TokenFlyweight::getToken(TokenType::IDENTIFIER, lexer.getInput().substr(start, end - start));
     }
     // Not an identifier, pass to next handler
     return nextHandler->handle();
@@ -97,14 +73,14 @@ std::shared_ptr<Token> NumberHandler::handle() {
     char c = lexer.current();
     // Check if character starts a number
     if (isdigit(static_cast<unsigned char>(c))) {
-        std::string value;
+        const ScanKernels& kernels = ScanKernels::active();
+        const std::string& input = lexer.getInput();
+        size_t start = lexer.pos();
         bool hasDecimal = false;
     
         // Process integer part (sequence of digits)
-        while (isdigit(static_cast<unsigned char>(lexer.current()))) {
-            value += lexer.current();
-            lexer.advance();
-        }
+        lexer.advance(kernels.digits(input, start) - start);
+        std::string value = input.substr(start, lexer.pos() - start);
     
         // Process decimal part if decimal point found
         if (lexer.current() == '.') {
@@ -117,10 +93,9 @@ std::shared_ptr<Token> NumberHandler::handle() {
                 return TokenFlyweight::getToken(TokenType::ERROR, "Invalid float: " + value);
         
             // Process fractional part
-            while (isdigit(static_cast<unsigned char>(lexer.current()))) {
-                value += lexer.current();
-                lexer.advance();
-            }
+            size_t fraction = lexer.pos();
+            lexer.advance(kernels.digits(input, fraction) - fraction);
+            value.append(input, fraction, lexer.pos() - fraction);
         
             // Check for multiple decimal points
             if (lexer.current() == '.') 
@@ -147,16 +122,18 @@ std::shared_ptr<Token> StringHandler::handle() {
         value += quote;
         lexer.advance();
     
-        // Collect characters until closing quote or end of input
-        while (lexer.current() != quote && lexer.current() != '\0') {
-            if (lexer.current() == '\\') {
-                // Handle escape sequences
-                value += lexer.current();
-                lexer.advance();
-                if (lexer.current() != '\0') value += lexer.current();
-            } else {
-                value += lexer.current();
-            }
+        // Collect runs of plain characters until closing quote or end of input
+        const std::string& input = lexer.getInput();
+        while (true) {
+            size_t start = lexer.pos();
+            size_t end = ScanKernels::active().string(input, start, quote);
+            if (end > start) value.append(input, start, end - start);
+            lexer.advance(end - start);
+            if (lexer.current() != '\\') break;
+            // Handle escape sequences
+            value += lexer.current();
+            lexer.advance();
+            if (lexer.current() != '\0') value += lexer.current();
             lexer.advance();
         }
     
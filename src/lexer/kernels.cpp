@@ -0,0 +1,219 @@
+/**
+ * @file src/lexer/kernels.cpp
+ * @brief Scalar and SIMD kernels scanning character runs.
+**/
+
+#include "lexer.hpp"
+#include <atomic>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define DEMOLANG_X86_64
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define DEMOLANG_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define DEMOLANG_TARGET_AVX2
+#endif
+
+using namespace DemoLang;
+using namespace DemoLang::LexerSpace;
+
+
+namespace DemoLang {
+
+namespace {
+
+bool isIdentifierChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+bool isDigitChar(char c) {
+    return c >= '0' && c <= '9';
+}
+
+bool endsString(char c, char quote) {
+    return c == quote || c == '\\' || c == '\0';
+}
+
+
+size_t scalarIdentifier(std::string_view input, size_t pos) {
+    while (pos < input.size() && isIdentifierChar(input[pos])) pos++;
+    return pos;
+}
+
+size_t scalarDigits(std::string_view input, size_t pos) {
+    while (pos < input.size() && isDigitChar(input[pos])) pos++;
+    return pos;
+}
+
+size_t scalarString(std::string_view input, size_t pos, char quote) {
+    while (pos < input.size() && !endsString(input[pos], quote)) pos++;
+    return pos;
+}
+
+
+#ifdef DEMOLANG_X86_64
+
+unsigned firstSet(unsigned mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// Bytes are compared as signed values, so bytes >= 0x80 never fall in a range
+__m128i inRange16(__m128i chunk, char low, char high) {
+    return _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8(low - 1)),
+                         _mm_cmplt_epi8(chunk, _mm_set1_epi8(high + 1)));
+}
+
+__m128i identifierMask16(__m128i chunk) {
+    __m128i lower = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+    return _mm_or_si128(_mm_or_si128(inRange16(lower, 'a', 'z'), inRange16(chunk, '0', '9')),
+                        _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_')));
+}
+
+size_t sse2Identifier(std::string_view input, size_t pos) {
+    for (; pos + 16 <= input.size(); pos += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input.data() + pos));
+        unsigned stop = ~_mm_movemask_epi8(identifierMask16(chunk)) & 0xFFFF;
+        if (stop) return pos + firstSet(stop);
+    }
+    return scalarIdentifier(input, pos);
+}
+
+size_t sse2Digits(std::string_view input, size_t pos) {
+    for (; pos + 16 <= input.size(); pos += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input.data() + pos));
+        unsigned stop = ~_mm_movemask_epi8(inRange16(chunk, '0', '9')) & 0xFFFF;
+        if (stop) return pos + firstSet(stop);
+    }
+    return scalarDigits(input, pos);
+}
+
+size_t sse2String(std::string_view input, size_t pos, char quote) {
+    for (; pos + 16 <= input.size(); pos += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input.data() + pos));
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(quote)),
+                                                 _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'))),
+                                    _mm_cmpeq_epi8(chunk, _mm_setzero_si128()));
+        unsigned stop = _mm_movemask_epi8(hits);
+        if (stop) return pos + firstSet(stop);
+    }
+    return scalarString(input, pos, quote);
+}
+
+
+DEMOLANG_TARGET_AVX2 __m256i inRange32(__m256i chunk, char low, char high) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(chunk, _mm256_set1_epi8(low - 1)),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(high + 1), chunk));
+}
+
+DEMOLANG_TARGET_AVX2 size_t avx2Identifier(std::string_view input, size_t pos) {
+    for (; pos + 32 <= input.size(); pos += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input.data() + pos));
+        __m256i lower = _mm256_or_si256(chunk, _mm256_set1_epi8(0x20));
+        __m256i mask = _mm256_or_si256(_mm256_or_si256(inRange32(lower, 'a', 'z'), inRange32(chunk, '0', '9')),
+                                       _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('_')));
+        unsigned stop = ~static_cast<unsigned>(_mm256_movemask_epi8(mask));
+        if (stop) return pos + firstSet(stop);
+    }
+    return sse2Identifier(input, pos);
+}
+
+DEMOLANG_TARGET_AVX2 size_t avx2Digits(std::string_view input, size_t pos) {
+    for (; pos + 32 <= input.size(); pos += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input.data() + pos));
+        unsigned stop = ~static_cast<unsigned>(_mm256_movemask_epi8(inRange32(chunk, '0', '9')));
+        if (stop) return pos + firstSet(stop);
+    }
+    return sse2Digits(input, pos);
+}
+
+DEMOLANG_TARGET_AVX2 size_t avx2String(std::string_view input, size_t pos, char quote) {
+    for (; pos + 32 <= input.size(); pos += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input.data() + pos));
+        __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(quote)),
+                                                       _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\'))),
+                                       _mm256_cmpeq_epi8(chunk, _mm256_setzero_si256()));
+        unsigned stop = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+        if (stop) return pos + firstSet(stop);
+    }
+    return sse2String(input, pos, quote);
+}
+
+
+bool hasAvx2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    // AVX2 also needs the OS to save the YMM registers
+    __cpuid(info, 1);
+    if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28))) return false;
+    if ((_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // DEMOLANG_X86_64
+
+
+const ScanKernels scalarKernels = {SimdLevel::SCALAR, scalarIdentifier, scalarDigits, scalarString};
+#ifdef DEMOLANG_X86_64
+const ScanKernels sse2Kernels = {SimdLevel::SSE2, sse2Identifier, sse2Digits, sse2String};
+const ScanKernels avx2Kernels = {SimdLevel::AVX2, avx2Identifier, avx2Digits, avx2String};
+#endif
+
+std::atomic<const ScanKernels*>& selected() {
+    static std::atomic<const ScanKernels*> kernels(&ScanKernels::forLevel(ScanKernels::detect()));
+    return kernels;
+}
+
+} // namespace
+
+
+SimdLevel LexerSpace::ScanKernels::detect() {
+#ifdef DEMOLANG_X86_64
+    // SSE2 is part of the x86-64 baseline, AVX2 is probed through CPUID
+    static const SimdLevel level = hasAvx2() ? SimdLevel::AVX2 : SimdLevel::SSE2;
+    return level;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+
+const ScanKernels& LexerSpace::ScanKernels::forLevel(SimdLevel level) {
+    // Never hand out kernels the CPU cannot run
+    if (level > detect()) level = detect();
+#ifdef DEMOLANG_X86_64
+    if (level == SimdLevel::AVX2) return avx2Kernels;
+    if (level == SimdLevel::SSE2) return sse2Kernels;
+#endif
+    return scalarKernels;
+}
+
+
+const ScanKernels& LexerSpace::ScanKernels::active() {
+    return *selected().load(std::memory_order_relaxed);
+}
+
+
+void LexerSpace::ScanKernels::select(SimdLevel level) {
+    selected().store(&forLevel(level), std::memory_order_relaxed);
+}
+
+} // namespace DemoLang
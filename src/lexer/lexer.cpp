@@ -29,6 +29,46 @@ std::vector<Token> LexerSpace::Lexer::tokenize(const std::string &input) {
     // Initialize lexer state
     this->input = input;
     this->position = 0;
+    if (mode == LexerMode::TABLE) return TableScanner(this->input).tokenize();
+    return tokenizeChain();
+}
+
+
+TokenStream LexerSpace::Lexer::scan(std::string source) {
+    if (mode == LexerMode::CHAIN) return TokenStream(tokenize(source));
+    // The stream takes ownership of the source, tokens only reference it
+    TokenStream stream(std::move(source));
+    TableScanner(stream.getSource()).scan(stream);
+    return stream;
+}
+
+
+Generator<TokenView> LexerSpace::Lexer::tokens(std::string_view source) {
+    if (mode == LexerMode::CHAIN) {
+        // The chain lexer has no incremental form, so its stream is replayed
+        TokenStream stream = scan(std::string(source));
+        for (size_t i = 0; i < stream.size(); i++) co_yield stream[i];
+        co_return;
+    }
+
+    TableScanner scanner(source);
+    std::string message;
+    for (Lexeme lexeme = scanner.next(); lexeme.type != TokenType::END; lexeme = scanner.next()) {
+        if (lexeme.type == TokenType::ERROR) {
+            // Tokenizing stops at the first error
+            message = scanner.text(lexeme);
+            co_yield TokenView{TokenType::ERROR, message};
+            break;
+        }
+        TokenView token{lexeme.type, source.substr(lexeme.begin, lexeme.end - lexeme.begin)};
+        token.hasLiteral = parseLiteral(token.type, token.value, token.literal);
+        co_yield token;
+    }
+    co_yield TokenView{TokenType::END, ""};
+}
+
+
+std::vector<Token> LexerSpace::Lexer::tokenizeChain() {
     std::vector<Token> tokens;
     Token token = this->nextToken();
     
@@ -0,0 +1,136 @@
+/**
+ * @file src/lexer/parallel.cpp
+ * @brief Tokenize large inputs on several threads.
+**/
+
+#include "lexer.hpp"
+#include <algorithm>
+#include <thread>
+#include <unordered_map>
+
+using namespace DemoLang;
+using namespace DemoLang::Tokens;
+using namespace DemoLang::LexerSpace;
+
+
+namespace DemoLang {
+
+namespace {
+
+/**
+ * @brief Tokens a worker scanned speculatively from a chunk boundary.
+**/
+struct ChunkResult {
+    std::vector<TokenSpan> spans;
+    std::vector<std::string_view> names;    // Identifiers by first use, their spans hold the index until the join
+    std::string error;
+    size_t end = 0;         // Position the worker stopped at
+    bool finished = false;  // Hit an error or the end of input
+};
+
+
+/**
+ * @brief Scan lexemes from begin until the next lexeme would start at or after limit.
+**/
+void scanChunk(std::string_view source, size_t begin, size_t limit, ChunkResult& result) {
+    TableScanner scanner(source, begin);
+    // Identifiers are numbered per chunk, so workers never contend on the symbol table
+    std::unordered_map<std::string_view, uint32_t> locals;
+    locals.reserve((limit - begin) / 32);
+    while (scanner.pos() < limit) {
+        Lexeme lexeme = scanner.next();
+        if (lexeme.type == TokenType::END) {
+            result.finished = true;
+            break;
+        }
+        if (lexeme.type == TokenType::ERROR) {
+            result.error = scanner.text(lexeme);
+            result.finished = true;
+            break;
+        }
+        size_t length = lexeme.end - lexeme.begin;
+        if (lexeme.type == TokenType::IDENTIFIER) {
+            auto [it, added] = locals.try_emplace(source.substr(lexeme.begin, length), static_cast<uint32_t>(result.names.size()));
+            if (added) result.names.push_back(it->first);
+            TokenSpan span = {TokenType::IDENTIFIER, true, static_cast<uint32_t>(lexeme.begin), static_cast<uint32_t>(length), {0}};
+            span.literal.symbol = it->second;
+            result.spans.push_back(span);
+            continue;
+        }
+        // Literals are parsed here too, so workers share that cost
+        result.spans.push_back(TokenStream::span(source, lexeme.type, lexeme.begin, length));
+    }
+    result.end = scanner.pos();
+}
+
+
+/**
+ * @brief Pick chunk boundaries on newlines, preferring ones a token ends right before.
+**/
+std::vector<size_t> splitPoints(std::string_view source, size_t chunks) {
+    std::vector<size_t> points = {0};
+    for (size_t i = 1; i < chunks; i++) {
+        size_t pos = std::max(points.back() + 1, source.size() * i / chunks);
+        // A newline after whitespace is itself scanned as an unknown character,
+        // so the sequential lexer could never stop right before it
+        while (pos < source.size() && (source[pos] != '\n' || TableScanner::classOf(source[pos - 1]) == CharClass::WHITESPACE)) pos++;
+        if (pos >= source.size()) break;
+        points.push_back(pos);
+    }
+    points.push_back(source.size());
+    return points;
+}
+
+} // namespace
+
+
+TokenStream LexerSpace::Lexer::scanParallel(std::string source, size_t threads, size_t minChunk) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t chunks = std::min(threads, source.size() / std::max<size_t>(minChunk, 1));
+    if (mode == LexerMode::CHAIN || chunks < 2) return scan(std::move(source));
+
+    // Rejects a source the spans cannot address before any worker starts
+    TokenStream stream(std::move(source));
+    std::string_view input = stream.getSource();
+    std::vector<size_t> points = splitPoints(input, chunks);
+    std::vector<ChunkResult> results(points.size() - 1);
+
+    // Each worker assumes a token starts exactly at its boundary
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < results.size(); i++) {
+        workers.emplace_back(scanChunk, input, points[i], points[i + 1], std::ref(results[i]));
+    }
+    scanChunk(input, points[0], points[1], results[0]);
+    for (auto& worker : workers) worker.join();
+
+    // Join in source order, rescanning sequentially wherever an assumption failed,
+    // e.g. when a string literal spans a boundary
+    size_t pos = 0;
+    std::vector<uint32_t> symbols;
+    for (size_t i = 0; i < results.size(); i++) {
+        ChunkResult resync;
+        ChunkResult* chunk = &results[i];
+        if (pos != points[i]) {
+            if (pos > points[i + 1]) continue;
+            scanChunk(input, pos, points[i + 1], resync);
+            chunk = &resync;
+        }
+        // Each name of the chunk is interned once, in source order as scan() does
+        symbols.clear();
+        for (std::string_view name : chunk->names) symbols.push_back(SymbolTable::instance().intern(name));
+        for (TokenSpan span : chunk->spans) {
+            if (span.type == TokenType::IDENTIFIER) span.literal.symbol = symbols[span.literal.symbol];
+            stream.push(span);
+        }
+        pos = chunk->end;
+        if (chunk->finished) {
+            if (!chunk->error.empty()) stream.pushError(chunk->error);
+            break;
+        }
+    }
+
+    stream.push(TokenType::END, std::min(pos, input.size()), 0);
+    return stream;
+}
+
+} // namespace DemoLang
@@ -0,0 +1,109 @@
+/**
+ * @file src/lexer/stream.cpp
+ * @brief Resumable lexer over chunked input.
+**/
+
+#include "lexer.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace DemoLang;
+using namespace DemoLang::Tokens;
+using namespace DemoLang::LexerSpace;
+
+
+namespace DemoLang {
+
+LexerSpace::StreamLexer::StreamLexer(std::function<size_t(char*, size_t)> reader, size_t chunkSize)
+    : reader(std::move(reader)), position(0), chunkSize(chunkSize ? chunkSize : defaultChunkSize),
+      exhausted(false), finished(false), failed(false) {}
+
+
+LexerSpace::StreamLexer::StreamLexer(std::istream& in, size_t chunkSize)
+    : StreamLexer([&in](char* data, size_t size) {
+          in.read(data, static_cast<std::streamsize>(size));
+          // End of input only sets eofbit and failbit, badbit means the stream itself failed
+          if (in.bad()) throw std::runtime_error("Cannot read input stream");
+          return static_cast<size_t>(in.gcount());
+      }, chunkSize) {}
+
+
+LexerSpace::StreamLexer::StreamLexer(int fd, size_t chunkSize)
+    : StreamLexer([fd](char* data, size_t size) {
+          while (true) {
+#ifdef _WIN32
+              int count = _read(fd, data, static_cast<unsigned>(size));
+#else
+              ssize_t count = ::read(fd, data, size);
+#endif
+              if (count >= 0) return static_cast<size_t>(count);
+              // A signal arriving before any data is not the end of the input
+              if (errno != EINTR) throw std::system_error(errno, std::generic_category(), "Cannot read input");
+          }
+      }, chunkSize) {}
+
+
+bool LexerSpace::StreamLexer::refill() {
+    if (exhausted) return false;
+    // Drop what has been consumed, keeping only the unfinished token
+    buffer.erase(0, position);
+    position = 0;
+    // Read at least as much as is carried over, so a token spanning many
+    // chunks is rescanned a logarithmic number of times
+    size_t size = buffer.size();
+    size_t wanted = std::max(chunkSize, size);
+    buffer.resize(size + wanted);
+    size_t count = 0;
+    try {
+        count = reader(buffer.data() + size, wanted);
+    } catch (const std::exception& e) {
+        // The input ends here, but not as a complete source
+        message = e.what();
+        failed = true;
+    }
+    buffer.resize(size + count);
+    if (count == 0) exhausted = true;
+    return !failed;
+}
+
+
+TokenView LexerSpace::StreamLexer::next() {
+    if (finished) return {TokenType::END, ""};
+
+    while (true) {
+        TableScanner scanner(buffer, position);
+        Lexeme lexeme = scanner.next();
+        // A lexeme that reached the end of the buffer may continue in the next chunk
+        if (scanner.pos() >= buffer.size() && refill()) continue;
+        if (failed) {
+            // The lexeme may be cut short, the failure is reported in its place
+            finished = true;
+            return {TokenType::ERROR, message};
+        }
+
+        position = scanner.pos();
+        if (lexeme.type == TokenType::END) {
+            finished = true;
+            return {TokenType::END, ""};
+        }
+        if (lexeme.type == TokenType::ERROR) {
+            // If there is an error, stop tokenizing
+            finished = true;
+            message = scanner.text(lexeme);
+            return {TokenType::ERROR, message};
+        }
+        TokenView token = {lexeme.type, std::string_view(buffer).substr(lexeme.begin, lexeme.end - lexeme.begin)};
+        token.hasLiteral = parseLiteral(token.type, token.value, token.literal);
+        return token;
+    }
+}
+
+} // namespace DemoLang
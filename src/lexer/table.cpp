@@ -0,0 +1,165 @@
+/**
+ * @file src/lexer/table.cpp
+ * @brief Table-driven single-pass scanner.
+**/
+
+#include "lexer.hpp"
+#include <algorithm>
+
+using namespace DemoLang;
+using namespace DemoLang::Tokens;
+using namespace DemoLang::LexerSpace;
+
+
+namespace DemoLang {
+
+const std::array<CharClass, 256>& LexerSpace::TableScanner::classes() {
+    // Built once from the same token definitions the handlers use
+    static const std::array<CharClass, 256> table = []() {
+        std::array<CharClass, 256> table;
+        table.fill(CharClass::UNKNOWN);
+        for (int c = 'a'; c <= 'z'; c++) table[c] = CharClass::IDENTIFIER;
+        for (int c = 'A'; c <= 'Z'; c++) table[c] = CharClass::IDENTIFIER;
+        table['_'] = CharClass::IDENTIFIER;
+        for (int c = '0'; c <= '9'; c++) table[c] = CharClass::DIGIT;
+        for (const auto& op : operators) table[static_cast<unsigned char>(op[0])] = CharClass::OPERATOR;
+        for (const auto& ws : whitespaces) table[static_cast<unsigned char>(ws[0])] = CharClass::WHITESPACE;
+        table['\"'] = table['\''] = CharClass::QUOTE;
+        table['\0'] = CharClass::END;
+        return table;
+    }();
+    return table;
+}
+
+
+LexerSpace::Lexeme LexerSpace::TableScanner::next() {
+    size_t begin = position;
+    CharClass cls = classOf(at(begin));
+    if (cls == CharClass::END) return {TokenType::END, LexError::NONE, begin, begin};
+
+    // A single whitespace character is skipped, then the next character is
+    // classified without another end-of-input or whitespace check
+    if (cls == CharClass::WHITESPACE) cls = classOf(at(++begin));
+
+    switch (cls) {
+        case CharClass::QUOTE:      return scanString(begin);
+        case CharClass::DIGIT:      return scanNumber(begin);
+        case CharClass::OPERATOR:   return scanOperator(begin);
+        case CharClass::IDENTIFIER: return scanIdentifier(begin);
+        default:
+            position = begin + 1;
+            return {TokenType::ERROR, LexError::UNKNOWN_CHARACTER, begin, position};
+    }
+}
+
+
+LexerSpace::Lexeme LexerSpace::TableScanner::scanString(size_t begin) {
+    char quote = at(begin);
+    // Collect characters until closing quote or end of input
+    size_t pos = kernels.string(input, begin + 1, quote);
+    while (at(pos) == '\\') {
+        // An escaped character is taken verbatim, even if it is a quote
+        pos = kernels.string(input, pos + 2, quote);
+    }
+    if (at(pos) == quote) {
+        position = pos + 1;
+        return {TokenType::STRING_LITERAL, LexError::NONE, begin, position};
+    }
+    position = pos;
+    return {TokenType::ERROR, LexError::UNTERMINATED_STRING, begin, std::min(pos, input.size())};
+}
+
+
+LexerSpace::Lexeme LexerSpace::TableScanner::scanNumber(size_t begin) {
+    size_t pos = kernels.digits(input, begin);
+
+    TokenType type = TokenType::INTEGER_LITERAL;
+    if (at(pos) == '.') {
+        type = TokenType::FLOAT_LITERAL;
+        // Must have at least one digit after decimal point
+        if (classOf(at(++pos)) != CharClass::DIGIT) {
+            position = pos;
+            return {TokenType::ERROR, LexError::INVALID_FLOAT, begin, pos};
+        }
+        pos = kernels.digits(input, pos);
+        if (at(pos) == '.') {
+            position = pos;
+            return {TokenType::ERROR, LexError::MULTIPLE_DECIMAL_POINTS, begin, pos};
+        }
+    }
+    position = pos;
+    return {type, LexError::NONE, begin, pos};
+}
+
+
+LexerSpace::Lexeme LexerSpace::TableScanner::scanOperator(size_t begin) {
+    // Operators are listed longest first, so the first match is the longest one
+    for (const auto& op : operators) {
+        if (input.compare(begin, op.length(), op) == 0) {
+            position = begin + op.length();
+            return {TokenType::OPERATOR, LexError::NONE, begin, position};
+        }
+    }
+    position = begin + 1;
+    return {TokenType::ERROR, LexError::UNKNOWN_CHARACTER, begin, position};
+}
+
+
+LexerSpace::Lexeme LexerSpace::TableScanner::scanIdentifier(size_t begin) {
+    size_t pos = kernels.identifier(input, begin + 1);
+    position = pos;
+    return {TokenType::IDENTIFIER, LexError::NONE, begin, pos};
+}
+
+
+std::string LexerSpace::TableScanner::text(const Lexeme& lexeme) const {
+    std::string value(input.substr(lexeme.begin, lexeme.end - lexeme.begin));
+    switch (lexeme.error) {
+        case LexError::INVALID_FLOAT:           return "Invalid float: " + value;
+        case LexError::MULTIPLE_DECIMAL_POINTS: return "Multiple decimal points";
+        case LexError::UNKNOWN_CHARACTER:       return "Unknown character: " + std::string(1, at(lexeme.begin));
+        case LexError::UNTERMINATED_STRING:     value = "Unterminated string: " + value; break;
+        case LexError::NONE:                    break;
+    }
+    // The chain never stores an escaped NUL inside a string literal
+    if (value.find('\0') != std::string::npos) {
+        auto last = std::unique(value.begin(), value.end(), [](char a, char b) { return a == '\\' && b == '\0'; });
+        value.erase(last, value.end());
+    }
+    return value;
+}
+
+
+Token LexerSpace::TableScanner::token(const Lexeme& lexeme) const {
+    return Token(lexeme.type, lexeme.type == TokenType::END ? "" : text(lexeme));
+}
+
+
+std::vector<Token> LexerSpace::TableScanner::tokenize() {
+    std::vector<Token> tokens;
+    for (Lexeme lexeme = next(); lexeme.type != TokenType::END; lexeme = next()) {
+        tokens.push_back(token(lexeme));
+        // If there is an error, stop tokenizing
+        if (lexeme.type == TokenType::ERROR) break;
+    }
+    // Add END token to mark completion
+    tokens.emplace_back(TokenType::END, "");
+    return tokens;
+}
+
+
+void LexerSpace::TableScanner::scan(TokenStream& stream) {
+    Lexeme lexeme = next();
+    for (; lexeme.type != TokenType::END; lexeme = next()) {
+        if (lexeme.type == TokenType::ERROR) {
+            // Only error messages are materialized, and tokenizing stops there
+            stream.pushError(text(lexeme));
+            lexeme = {TokenType::END, LexError::NONE, position, position};
+            break;
+        }
+        stream.push(lexeme.type, lexeme.begin, lexeme.end - lexeme.begin);
+    }
+    stream.push(TokenType::END, std::min(lexeme.begin, input.size()), 0);
+}
+
+} // namespace DemoLang
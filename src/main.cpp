@@ -7,7 +7,12 @@
 #include "lexer.hpp"
 #include "parser.hpp"
 #include "interpreter.hpp"
+#include "optimizer.hpp"
+#include "closure.hpp"
+#include "regvm.hpp"
+#include "vm.hpp"
 #include <iostream>
+#include <string>
 
 using namespace DemoLang;
 using namespace DemoLang::Tokens;
@@ -16,12 +21,26 @@ using namespace DemoLang::AST;
 using namespace DemoLang::ParserSpace;
 using namespace DemoLang::ValueTypes;
 using namespace DemoLang::InterpreterSpace;
+using namespace DemoLang::OptimizerSpace;
+using namespace DemoLang::VMSpace;
+
+
+/**
+ * @brief Evaluator running each line, all give the same results.
+**/
+enum class Engine {
+    FLAT,       // Interpreter over the flat tree
+    TREE,       // Interpreter over the pointer tree
+    VM,         // Bytecode on the stack machine
+    REGISTER,   // Three-address code on the register machine
+    CLOSURE     // Tree of pre-bound closures
+};
 
 
 /**
  * @brief REPL for DemoLang.
 **/
-static void repl() {
+static void repl(Engine engine) {
     std::cout << "[DemoLang]" << std::endl << std::endl;
 
     // Main REPL loop
@@ -34,17 +53,22 @@ static void repl() {
         if (input.empty()) continue;
 
         try {
-            // Lexical analysis (tokenization) - convert input string to tokens
-            Lexer& lexer = Lexer::instance();
-            auto tokens = lexer.tokenize(input);
-
-            // Syntax analysis (parsing) - convert tokens to Abstract Syntax Tree
+            // Lexical and syntax analysis - tokens are pulled by the parser
+            // as it builds the Abstract Syntax Tree
             Parser& parser = Parser::instance();
-            auto ast = parser.parse(tokens);
+            auto ast = Optimizer::instance().optimize(parser.parseSource(input));
             
-            // Semantic analysis and execution (interpretation) - evaluate AST
+            // Semantic analysis and execution (interpretation) - by default
+            // evaluate the AST flattened into a contiguous node array
             Interpreter& interpreter = Interpreter::instance();
-            auto result = interpreter.interpret(ast);
+            std::string result;
+            switch (engine) {
+                case Engine::FLAT:      result = interpreter.interpret(FlatAST(*ast, interpreter.getMaxDepth())); break;
+                case Engine::TREE:      result = interpreter.interpret(ast); break;
+                case Engine::VM:        result = VM::instance().interpret(ast); break;
+                case Engine::REGISTER:  result = RegisterVM::instance().interpret(ast); break;
+                case Engine::CLOSURE:   result = ClosureEngine::instance().interpret(ast); break;
+            }
 
             // Print result
             std::cout << ">>> " << result << std::endl;
@@ -63,7 +87,28 @@ static void repl() {
  * @return Exit status code.
 **/
 int main(int argc, char* argv[]) {
-    repl();
+    Engine engine = Engine::FLAT;
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--no-fold") {
+            // Evaluate trees exactly as parsed
+            Optimizer::instance().setEnabled(false);
+        } else if (option == "--engine=flat") {
+            engine = Engine::FLAT;
+        } else if (option == "--engine=tree") {
+            engine = Engine::TREE;
+        } else if (option == "--engine=vm") {
+            engine = Engine::VM;
+        } else if (option == "--engine=register") {
+            engine = Engine::REGISTER;
+        } else if (option == "--engine=closure") {
+            engine = Engine::CLOSURE;
+        } else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return 1;
+        }
+    }
+    repl(engine);
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,67 @@
+/**
+ * @file src/optimizer/liveness.cpp
+ * @brief Find the statements of a program its result depends on.
+**/
+
+#include "optimizer.hpp"
+#include <unordered_set>
+
+
+namespace DemoLang {
+
+std::vector<bool> OptimizerSpace::Liveness::analyze(const Program& program) {
+    std::vector<bool> live(program.size(), false);
+    // Variables a later live statement may read before assigning them
+    std::unordered_set<uint32_t> needed;
+
+    // Backwards from the last statement, whose value is the result
+    for (size_t i = program.size(); i-- > 0;) {
+        reads.clear();
+        writes.clear();
+        pending.assign(1, program[i].node.get());
+        while (!pending.empty()) {
+            ASTNode* node = pending.back();
+            pending.pop_back();
+            if (node) node->accept(*this);
+        }
+
+        bool used = i + 1 == program.size();
+        for (uint32_t symbol : writes) used = used || needed.count(symbol) > 0;
+        if (!used) continue;
+        live[i] = true;
+        // Every assignment of a statement runs, reads are added back after
+        // so a read that comes before an assignment in it stays needed
+        for (uint32_t symbol : writes) needed.erase(symbol);
+        needed.insert(reads.begin(), reads.end());
+    }
+    return live;
+}
+
+
+void OptimizerSpace::Liveness::visit(UnaryOpNode& node) {
+    pending.push_back(node.getOperand());
+}
+
+
+void OptimizerSpace::Liveness::visit(BinaryOpNode& node) {
+    if (auto* target = dynamic_cast<IdNode*>(node.getLeft()); target && operatorOf(node.getOp()) == Operator::ASSIGN) {
+        writes.push_back(target->getSymbol());
+        pending.push_back(node.getRight());
+        return;
+    }
+    // An invalid target is still evaluated, with any assignment inside it
+    pending.push_back(node.getLeft());
+    pending.push_back(node.getRight());
+}
+
+
+void OptimizerSpace::Liveness::visit(NaryOpNode& node) {
+    for (size_t i = 0; i < node.size(); i++) pending.push_back(node.getOperand(i));
+}
+
+
+void OptimizerSpace::Liveness::visit(IdNode& node) {
+    reads.push_back(node.getSymbol());
+}
+
+} // namespace DemoLang
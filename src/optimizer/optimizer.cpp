@@ -0,0 +1,295 @@
+/**
+ * @file src/optimizer/optimizer.cpp
+ * @brief Constant folding and algebraic simplification.
+**/
+
+#include "optimizer.hpp"
+#include "interpreter.hpp"
+
+using namespace DemoLang::InterpreterSpace;
+
+
+namespace DemoLang {
+
+namespace {
+
+bool within(uint8_t kinds, uint8_t allowed) {
+    return (kinds & ~allowed) == 0;
+}
+
+// Kinds of an Integer literal
+uint8_t integerKinds(long long value) {
+    return value == 0 || value == 1 ? OptimizerSpace::BOOLEAN : OptimizerSpace::INTEGER;
+}
+
+bool isInteger(const std::shared_ptr<ASTNode>& node, long long value) {
+    auto* literal = dynamic_cast<IntNode*>(node.get());
+    return literal && literal->getValue() == value;
+}
+
+} // namespace
+
+
+uint8_t OptimizerSpace::unaryKinds(Operator op, uint8_t operand) {
+    // Non-numeric operands give "Operand must be numeric"
+    uint8_t error = within(operand, NUMERIC) ? 0 : EXCEPTION;
+    switch (op) {
+        case Operator::MINUS:
+            return ((operand & INTEGRAL) ? INTEGRAL : 0) | (operand & FLOAT) | error;
+        case Operator::NOT:
+            return ((operand & NUMERIC) ? BOOLEAN : 0) | error;
+        default:
+            return EXCEPTION;
+    }
+}
+
+
+uint8_t OptimizerSpace::binaryKinds(Operator op, uint8_t left, uint8_t right) {
+    bool numeric = within(left, NUMERIC) && within(right, NUMERIC);
+    // Integer operands give an Integer, a Float operand gives a Float
+    uint8_t arithmetic = ((left & INTEGRAL) && (right & INTEGRAL) ? INTEGRAL : 0)
+                       | ((left & NUMERIC) && (right & NUMERIC) && ((left | right) & FLOAT) ? FLOAT : 0);
+    switch (op) {
+        case Operator::PLUS:
+            return arithmetic | ((left & STRING) && (right & STRING) ? STRING : 0) | (numeric ? 0 : EXCEPTION);
+        case Operator::MINUS:
+        case Operator::MULTIPLY:
+            return arithmetic | (numeric ? 0 : EXCEPTION);
+        case Operator::DIVIDE:
+            // Always a Float, or "Division by zero"
+            return FLOAT | EXCEPTION;
+        case Operator::EQUAL:
+        case Operator::NOT_EQUAL:
+            return BOOLEAN | (numeric || (left == STRING && right == STRING) ? 0 : EXCEPTION);
+        case Operator::LESS:
+        case Operator::LESS_EQUAL:
+        case Operator::GREATER:
+        case Operator::GREATER_EQUAL:
+            return BOOLEAN | (numeric ? 0 : EXCEPTION);
+        case Operator::AND:
+        case Operator::OR:
+            return BOOLEAN;
+        case Operator::ASSIGN:
+            // Callers know whether the target is an identifier
+            return right | EXCEPTION;
+        default:
+            return EXCEPTION;
+    }
+}
+
+
+std::shared_ptr<ASTNode> OptimizerSpace::Optimizer::optimize(const std::shared_ptr<ASTNode>& root) {
+    if (!enabled || !root) return root;
+
+    arena = std::make_shared<ASTArena>();
+    tasks.assign(1, Task{root.get(), false});
+    built.clear();
+    while (!tasks.empty()) {
+        Task task = tasks.back();
+        tasks.pop_back();
+        combine = task.combine;
+        task.node->accept(*this);
+    }
+    Folded result = pop();
+    std::shared_ptr<ASTArena> nodes = std::move(arena);
+    if (!result.changed) return root;
+
+    // The result mixes new nodes with untouched subtrees of the input
+    auto owner = std::make_shared<std::pair<std::shared_ptr<ASTArena>, std::shared_ptr<ASTNode>>>(nodes, root);
+    return std::shared_ptr<ASTNode>(owner, result.node.get());
+}
+
+
+Value OptimizerSpace::Optimizer::valueOf(ASTNode* node) {
+    if (auto* literal = dynamic_cast<IntNode*>(node)) return Value::makeInteger(literal->getValue());
+    if (auto* literal = dynamic_cast<FloatNode*>(node)) return Value::makeFloat(literal->getValue());
+    if (auto* literal = dynamic_cast<StringNode*>(node)) return Value::makeString(literal->getValue());
+    if (auto* error = dynamic_cast<ErrorNode*>(node)) return Value::makeException(error->getMessage());
+    return Value();
+}
+
+
+OptimizerSpace::Optimizer::Folded OptimizerSpace::Optimizer::pop() {
+    Folded folded = std::move(built.back());
+    built.pop_back();
+    return folded;
+}
+
+
+void OptimizerSpace::Optimizer::fold(const Value& value) {
+    // The literal evaluates back to the same value
+    counters.folded++;
+    if (value.isInteger()) {
+        built.push_back({arena->make<IntNode>(value.getInteger()), integerKinds(value.getInteger()), true});
+    } else if (value.isFloat()) {
+        built.push_back({arena->make<FloatNode>(value.getFloat()), FLOAT, true});
+    } else if (value.isString()) {
+        built.push_back({arena->make<StringNode>(value.getString()), STRING, true});
+    } else {
+        built.push_back({arena->make<ErrorNode>(value.getString()), EXCEPTION, true});
+    }
+}
+
+
+void OptimizerSpace::Optimizer::keep(Folded operand) {
+    // The operation is an identity, its operand replaces it
+    counters.simplified++;
+    operand.changed = true;
+    built.push_back(std::move(operand));
+}
+
+
+void OptimizerSpace::Optimizer::visit(UnaryOpNode& node) {
+    if (!combine) {
+        tasks.push_back({&node, true});
+        tasks.push_back({node.getOperand(), false});
+        return;
+    }
+    Folded operand = pop();
+    Operator op = operatorOf(node.getOp());
+    if (Value value = valueOf(operand.node.get()); !value.isNone()) return fold(UnaryOperatorFactory::execute(op, value));
+
+    // -(-x) and !(!x) cancel when x already has a kind the pair gives back unchanged
+    auto* inner = dynamic_cast<UnaryOpNode*>(operand.node.get());
+    if (inner && inner->getOp() == node.getOp()) {
+        if ((op == Operator::MINUS && within(operand.operandKinds, NUMERIC)) ||
+            (op == Operator::NOT && within(operand.operandKinds, BOOLEAN))) {
+            return keep({ASTArena::borrow(inner->getOperand()), operand.operandKinds, true});
+        }
+    }
+
+    uint8_t kinds = unaryKinds(op, operand.kinds);
+    if (!operand.changed) built.push_back({ASTArena::borrow(&node), kinds, false, operand.kinds});
+    else built.push_back({arena->make<UnaryOpNode>(node.getOp(), operand.node), kinds, true, operand.kinds});
+}
+
+
+void OptimizerSpace::Optimizer::visit(BinaryOpNode& node) {
+    if (!combine) {
+        // Left operand first, then right operand
+        tasks.push_back({&node, true});
+        tasks.push_back({node.getRight(), false});
+        tasks.push_back({node.getLeft(), false});
+        return;
+    }
+    Folded right = pop();
+    Folded left = pop();
+    Operator op = operatorOf(node.getOp());
+
+    if (op == Operator::ASSIGN) {
+        // Assignment has a side effect and is never folded
+        bool target = dynamic_cast<IdNode*>(node.getLeft()) != nullptr;
+        if (!target && dynamic_cast<IdNode*>(left.node.get())) {
+            // A simplified operand must not turn an invalid target into a valid one
+            left = {ASTArena::borrow(node.getLeft()), ANY, false};
+        }
+        uint8_t kinds = target ? right.kinds : static_cast<uint8_t>(EXCEPTION);
+        if (!left.changed && !right.changed) built.push_back({ASTArena::borrow(&node), kinds, false});
+        else built.push_back({arena->make<BinaryOpNode>(node.getOp(), left.node, right.node), kinds, true});
+        return;
+    }
+
+    Value leftValue = valueOf(left.node.get());
+    Value rightValue = valueOf(right.node.get());
+    if (!leftValue.isNone() && !rightValue.isNone()) return fold(BinOperatorFactory::execute(op, leftValue, rightValue));
+
+    // Identities, x + 0 keeps the sign of a negative zero Float, so it only holds for Integers
+    switch (op) {
+        case Operator::MULTIPLY:
+            if (isInteger(right.node, 1) && within(left.kinds, NUMERIC)) return keep(std::move(left));
+            if (isInteger(left.node, 1) && within(right.kinds, NUMERIC)) return keep(std::move(right));
+            break;
+        case Operator::PLUS:
+            if (isInteger(right.node, 0) && within(left.kinds, INTEGRAL)) return keep(std::move(left));
+            if (isInteger(left.node, 0) && within(right.kinds, INTEGRAL)) return keep(std::move(right));
+            break;
+        case Operator::MINUS:
+            if (isInteger(right.node, 0) && within(left.kinds, NUMERIC)) return keep(std::move(left));
+            break;
+        default:
+            break;
+    }
+
+    uint8_t kinds = binaryKinds(op, left.kinds, right.kinds);
+    if (op == Operator::PLUS || op == Operator::MULTIPLY) {
+        // A left operand with the same operator continues the chain, evaluation order is unchanged
+        if (auto* chain = dynamic_cast<NaryOpNode*>(left.node.get()); chain && chain->getOp() == node.getOp()) {
+            if (left.fresh) {
+                chain->append(right.node);
+                left.kinds = kinds;
+                built.push_back(std::move(left));
+                return;
+            }
+            std::vector<std::shared_ptr<ASTNode>> operands = chain->getOperands();
+            operands.push_back(right.node);
+            built.push_back({arena->make<NaryOpNode>(node.getOp(), std::move(operands)), kinds, true, ANY, true});
+            return;
+        }
+        if (auto* inner = dynamic_cast<BinaryOpNode*>(left.node.get()); inner && inner->getOp() == node.getOp()) {
+            counters.flattened++;
+            std::vector<std::shared_ptr<ASTNode>> operands = {
+                ASTArena::borrow(inner->getLeft()), ASTArena::borrow(inner->getRight()), right.node
+            };
+            built.push_back({arena->make<NaryOpNode>(node.getOp(), std::move(operands)), kinds, true, ANY, true});
+            return;
+        }
+    }
+
+    if (!left.changed && !right.changed) built.push_back({ASTArena::borrow(&node), kinds, false});
+    else built.push_back({arena->make<BinaryOpNode>(node.getOp(), left.node, right.node), kinds, true});
+}
+
+
+void OptimizerSpace::Optimizer::visit(NaryOpNode& node) {
+    if (!combine) {
+        tasks.push_back({&node, true});
+        for (size_t i = node.size(); i-- > 0;) tasks.push_back({node.getOperand(i), false});
+        return;
+    }
+    std::vector<Folded> operands(std::make_move_iterator(built.end() - node.size()), std::make_move_iterator(built.end()));
+    built.resize(built.size() - node.size());
+    Operator op = operatorOf(node.getOp());
+
+    std::vector<Value> values;
+    for (const Folded& operand : operands) {
+        Value value = valueOf(operand.node.get());
+        if (value.isNone()) break;
+        values.push_back(std::move(value));
+    }
+    if (values.size() == operands.size()) return fold(BinOperatorFactory::executeChain(op, values));
+
+    uint8_t kinds = operands[0].kinds;
+    bool changed = operands[0].changed;
+    for (size_t i = 1; i < operands.size(); i++) {
+        kinds = binaryKinds(op, kinds, operands[i].kinds);
+        changed = changed || operands[i].changed;
+    }
+    if (!changed) return built.push_back({ASTArena::borrow(&node), kinds, false});
+    std::vector<std::shared_ptr<ASTNode>> nodes;
+    for (Folded& operand : operands) nodes.push_back(std::move(operand.node));
+    built.push_back({arena->make<NaryOpNode>(node.getOp(), std::move(nodes)), kinds, true, ANY, true});
+}
+
+
+void OptimizerSpace::Optimizer::visit(IdNode& node) {
+    // A variable may hold any value, including an Exception
+    built.push_back({ASTArena::borrow(&node), ANY, false});
+}
+
+void OptimizerSpace::Optimizer::visit(IntNode& node) {
+    built.push_back({ASTArena::borrow(&node), integerKinds(node.getValue()), false});
+}
+
+void OptimizerSpace::Optimizer::visit(FloatNode& node) {
+    built.push_back({ASTArena::borrow(&node), FLOAT, false});
+}
+
+void OptimizerSpace::Optimizer::visit(StringNode& node) {
+    built.push_back({ASTArena::borrow(&node), STRING, false});
+}
+
+void OptimizerSpace::Optimizer::visit(ErrorNode& node) {
+    built.push_back({ASTArena::borrow(&node), EXCEPTION, false});
+}
+
+} // namespace DemoLang
@@ -0,0 +1,398 @@
+/**
+ * @file src/parser/flat.cpp
+ * @brief Flatten pointer trees into contiguous node arrays and back.
+**/
+
+#include "flat.hpp"
+#include <charconv>
+#include <sstream>
+#include <unordered_map>
+
+using namespace DemoLang;
+using namespace DemoLang::AST;
+
+
+namespace DemoLang {
+
+namespace {
+
+// Opcode of a binary operator, assignment has its own encoding
+OpCode binaryCode(Operator op) {
+    switch (op) {
+        case Operator::PLUS:          return OpCode::ADD;
+        case Operator::MINUS:         return OpCode::SUB;
+        case Operator::MULTIPLY:      return OpCode::MUL;
+        case Operator::DIVIDE:        return OpCode::DIV;
+        case Operator::EQUAL:         return OpCode::EQ;
+        case Operator::NOT_EQUAL:     return OpCode::NE;
+        case Operator::LESS:          return OpCode::LT;
+        case Operator::LESS_EQUAL:    return OpCode::LE;
+        case Operator::GREATER:       return OpCode::GT;
+        case Operator::GREATER_EQUAL: return OpCode::GE;
+        case Operator::AND:           return OpCode::AND;
+        case Operator::OR:            return OpCode::OR;
+        default:                      return OpCode::INVALID_BINARY;
+    }
+}
+
+// Appends the nodes of a pointer tree to a flat tree in post-order, with an
+// explicit work stack so deep trees do not grow the C++ stack
+class FlatBuilder : public ASTVisitor {
+private:
+    struct Task {
+        ASTNode* node;
+        uint32_t depth;
+        bool combine;
+    };
+
+    FlatAST& tree;
+    std::vector<Task> tasks;
+    std::vector<uint32_t> built;    // Indices of finished operands
+    Task task{};                    // Task being visited
+
+    uint32_t pop() {
+        uint32_t index = built.back();
+        built.pop_back();
+        return index;
+    }
+
+    // Visit the node again once the given operands are built, the first one first
+    void schedule(ASTNode& node, ASTNode* first, ASTNode* second = nullptr) {
+        tasks.push_back({&node, task.depth, true});
+        if (second) tasks.push_back({second, task.depth + 1, false});
+        tasks.push_back({first, task.depth + 1, false});
+    }
+
+public:
+    explicit FlatBuilder(FlatAST& tree) : tree(tree) {}
+
+    uint32_t build(ASTNode* root) {
+        tasks.assign(1, Task{root, 1, false});
+        built.clear();
+        while (!tasks.empty()) {
+            task = tasks.back();
+            tasks.pop_back();
+            if (task.depth > tree.getMaxDepth()) {
+                // Interpreter::evaluate stops here, the nodes so far keep their side effects
+                tasks.clear();
+                return tree.node(OpCode::ERROR, tree.addString("Maximum evaluation depth exceeded"));
+            }
+            task.node->accept(*this);
+        }
+        return built.back();
+    }
+
+    void visit(UnaryOpNode& node) override {
+        if (!task.combine) return schedule(node, node.getOperand());
+        uint32_t operand = pop();
+        switch (operatorOf(node.getOp())) {
+            case Operator::MINUS: built.push_back(tree.node(OpCode::NEG, operand)); break;
+            case Operator::NOT:   built.push_back(tree.node(OpCode::NOT, operand)); break;
+            default:              built.push_back(tree.node(OpCode::INVALID_UNARY, operand, tree.addString(node.getOp()))); break;
+        }
+    }
+
+    void visit(BinaryOpNode& node) override {
+        Operator op = operatorOf(node.getOp());
+        auto* target = op == Operator::ASSIGN ? dynamic_cast<IdNode*>(node.getLeft()) : nullptr;
+        if (target) {
+            // Reading the target has no effect, so only the value is encoded
+            if (!task.combine) return schedule(node, node.getRight());
+            built.push_back(tree.assign(target->getSymbol(), pop()));
+            return;
+        }
+        if (!task.combine) return schedule(node, node.getLeft(), node.getRight());
+        uint32_t right = pop();
+        uint32_t left = pop();
+        built.push_back(tree.node(op == Operator::ASSIGN ? OpCode::INVALID_ASSIGN : binaryCode(op), left, right));
+    }
+
+    void visit(NaryOpNode& node) override {
+        if (!task.combine) {
+            tasks.push_back({&node, task.depth, true});
+            for (size_t i = node.size(); i-- > 0;) tasks.push_back({node.getOperand(i), task.depth + 1, false});
+            return;
+        }
+        std::vector<uint32_t> operands(built.end() - node.size(), built.end());
+        built.resize(built.size() - node.size());
+        Operator op = operatorOf(node.getOp());
+        if (op == Operator::PLUS || op == Operator::MULTIPLY) {
+            built.push_back(tree.chain(op == Operator::PLUS ? OpCode::SUM : OpCode::PRODUCT, operands));
+            return;
+        }
+        // Other operators are encoded as the left-deep chain they stand for
+        uint32_t left = operands[0];
+        for (size_t i = 1; i < operands.size(); i++) left = tree.node(binaryCode(op), left, operands[i]);
+        built.push_back(left);
+    }
+
+    void visit(IdNode& node) override { built.push_back(tree.load(node.getSymbol())); }
+    void visit(IntNode& node) override { built.push_back(tree.node(OpCode::INT, tree.addInteger(node.getValue()))); }
+    void visit(FloatNode& node) override { built.push_back(tree.node(OpCode::FLOAT, tree.addFloat(node.getValue()))); }
+    void visit(StringNode& node) override { built.push_back(tree.node(OpCode::STRING, tree.addString(node.getValue()))); }
+    void visit(ErrorNode& node) override { built.push_back(tree.node(OpCode::ERROR, tree.addString(node.getMessage()))); }
+};
+
+// Identity of a node, equal keys mean structurally equal subtrees
+struct NodeKey {
+    OpCode op;
+    uint32_t a;
+    uint32_t b;
+    bool operator==(const NodeKey& other) const { return op == other.op && a == other.a && b == other.b; }
+};
+
+struct NodeKeyHash {
+    size_t operator()(const NodeKey& key) const {
+        uint64_t packed = (static_cast<uint64_t>(key.a) << 32) | key.b;
+        return std::hash<uint64_t>()(packed * 31 + static_cast<uint8_t>(key.op));
+    }
+};
+
+} // namespace
+
+
+// Lookup tables used while encoding, literals are keyed by their exact value
+struct AST::FlatAST::Consing {
+    std::unordered_map<NodeKey, uint32_t, NodeKeyHash> nodes;
+    std::unordered_map<long long, uint32_t> integers;
+    std::unordered_map<std::string, uint32_t> floats;    // Shortest round-trip text
+    std::unordered_map<std::string, uint32_t> strings;
+    std::unordered_map<uint32_t, uint32_t> assignments;  // Per symbol
+    std::unordered_map<uint32_t, StaticType> variables;  // Type last assigned, per symbol
+    std::unordered_map<std::string, uint32_t> chains;    // Operator and operands, as bytes
+};
+
+
+AST::FlatAST::FlatAST() : consing(std::make_unique<Consing>()) {}
+AST::FlatAST::FlatAST(FlatAST&& other) noexcept = default;
+AST::FlatAST& AST::FlatAST::operator=(FlatAST&& other) noexcept = default;
+AST::FlatAST::~FlatAST() = default;
+
+
+AST::FlatAST::FlatAST(ASTNode& root, size_t maxDepth) : FlatAST() {
+    this->maxDepth = maxDepth;
+    append(root);
+}
+
+
+uint32_t AST::FlatAST::append(ASTNode& root) {
+    // The root may be a node an earlier statement already computes
+    roots.push_back(FlatBuilder(*this).build(&root));
+    ends.push_back(static_cast<uint32_t>(nodes.size()));
+    return roots.back();
+}
+
+
+uint32_t AST::FlatAST::node(OpCode op, uint32_t a, uint32_t b) {
+    // Every operation but assignment is pure, so equal keys can share a node
+    auto [it, inserted] = consing->nodes.try_emplace(NodeKey{op, a, b}, static_cast<uint32_t>(nodes.size()));
+    if (inserted) push({op, a, b});
+    return it->second;
+}
+
+
+uint32_t AST::FlatAST::load(uint32_t symbol) {
+    // Reads separated by an assignment to the variable are different values
+    auto it = consing->assignments.find(symbol);
+    return node(OpCode::LOAD, symbol, it == consing->assignments.end() ? 0 : it->second);
+}
+
+
+uint32_t AST::FlatAST::assign(uint32_t symbol, uint32_t value) {
+    consing->assignments[symbol]++;
+    consing->variables[symbol] = types[value];
+    return push({OpCode::ASSIGN, symbol, value});
+}
+
+
+uint32_t AST::FlatAST::chain(OpCode op, const std::vector<uint32_t>& operands) {
+    // Chains are pure as well, equal operator and operands share a node
+    std::string key(reinterpret_cast<const char*>(operands.data()), operands.size() * sizeof(uint32_t));
+    key.push_back(static_cast<char>(op));
+    auto [it, inserted] = consing->chains.try_emplace(std::move(key), static_cast<uint32_t>(nodes.size()));
+    if (inserted) {
+        FlatNode node{op, static_cast<uint32_t>(chains.size()), static_cast<uint32_t>(operands.size())};
+        chains.insert(chains.end(), operands.begin(), operands.end());
+        push(node);
+    }
+    return it->second;
+}
+
+
+uint32_t AST::FlatAST::push(const FlatNode& node) {
+    types.push_back(infer(node));
+    nodes.push_back(node);
+    return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+
+StaticType AST::FlatAST::infer(const FlatNode& node) const {
+    // Mirrors the operator factories: a type is only given where no operand
+    // values of the known types can lead to an exception or to another type
+    auto both = [&](StaticType type) { return types[node.a] == type && types[node.b] == type; };
+    auto numeric = [&]() { return isNumeric(types[node.a]) && isNumeric(types[node.b]); };
+    switch (node.op) {
+        case OpCode::INT:       return StaticType::INTEGER;
+        case OpCode::FLOAT:     return StaticType::FLOAT;
+        case OpCode::STRING:    return StaticType::STRING;
+        case OpCode::LOAD: {
+            if (node.b == 0) return StaticType::DYNAMIC;
+            auto it = consing->variables.find(node.a);
+            return it == consing->variables.end() ? StaticType::DYNAMIC : it->second;
+        }
+        case OpCode::NEG:       return isNumeric(types[node.a]) ? types[node.a] : StaticType::DYNAMIC;
+        case OpCode::NOT:       return isNumeric(types[node.a]) ? StaticType::INTEGER : StaticType::DYNAMIC;
+        case OpCode::ADD:
+            if (both(StaticType::STRING)) return StaticType::STRING;
+            [[fallthrough]];
+        case OpCode::SUB:
+        case OpCode::MUL:
+            if (both(StaticType::INTEGER)) return StaticType::INTEGER;
+            return numeric() ? StaticType::FLOAT : StaticType::DYNAMIC;
+        case OpCode::DIV: {
+            // Only a constant divisor rules out division by zero
+            const FlatNode& divisor = nodes[node.b];
+            bool nonzero = (divisor.op == OpCode::INT && integers[divisor.a] != 0)
+                || (divisor.op == OpCode::FLOAT && floats[divisor.a] != 0);
+            return numeric() && nonzero ? StaticType::FLOAT : StaticType::DYNAMIC;
+        }
+        case OpCode::EQ:
+        case OpCode::NE:
+            if (both(StaticType::STRING)) return StaticType::INTEGER;
+            [[fallthrough]];
+        case OpCode::LT:
+        case OpCode::LE:
+        case OpCode::GT:
+        case OpCode::GE:
+            return numeric() ? StaticType::INTEGER : StaticType::DYNAMIC;
+        case OpCode::AND:
+        case OpCode::OR:        return StaticType::INTEGER;
+        case OpCode::ASSIGN:    return types[node.b];
+        case OpCode::SUM:
+        case OpCode::PRODUCT: {
+            // Integers as long as every operand is one, a single Float promotes the chain
+            if (node.b == 0) return StaticType::DYNAMIC;
+            bool integral = true, real = true, text = node.op == OpCode::SUM;
+            for (uint32_t k = 0; k < node.b; k++) {
+                StaticType type = types[chains[node.a + k]];
+                integral = integral && type == StaticType::INTEGER;
+                real = real && isNumeric(type);
+                text = text && type == StaticType::STRING;
+            }
+            if (integral) return StaticType::INTEGER;
+            if (real) return StaticType::FLOAT;
+            return text ? StaticType::STRING : StaticType::DYNAMIC;
+        }
+        default:                return StaticType::DYNAMIC;
+    }
+}
+
+
+uint32_t AST::FlatAST::addInteger(long long value) {
+    auto [it, inserted] = consing->integers.try_emplace(value, static_cast<uint32_t>(integers.size()));
+    if (inserted) integers.push_back(value);
+    return it->second;
+}
+
+
+uint32_t AST::FlatAST::addFloat(long double value) {
+    char buffer[64];
+    auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    auto [it, inserted] = consing->floats.try_emplace(std::string(buffer, end), static_cast<uint32_t>(floats.size()));
+    if (inserted) floats.push_back(value);
+    return it->second;
+}
+
+
+uint32_t AST::FlatAST::addString(const std::string& value) {
+    auto [it, inserted] = consing->strings.try_emplace(value, static_cast<uint32_t>(strings.size()));
+    if (inserted) strings.push_back(value);
+    return it->second;
+}
+
+
+std::shared_ptr<ASTNode> AST::FlatAST::toTree(size_t statement) const {
+    if (statement >= roots.size()) return nullptr;
+    // Post-order means every child is already built when its parent is reached.
+    // Nodes live in one arena, so releasing a deep tree does not recurse.
+    auto arena = std::make_shared<ASTArena>();
+    std::vector<std::shared_ptr<ASTNode>> built(ends[statement]);
+    for (size_t i = 0; i < built.size(); i++) {
+        const FlatNode& node = nodes[i];
+        switch (node.op) {
+            case OpCode::INT:    built[i] = arena->make<IntNode>(integers[node.a]); break;
+            case OpCode::FLOAT:  built[i] = arena->make<FloatNode>(floats[node.a]); break;
+            case OpCode::STRING: built[i] = arena->make<StringNode>(strings[node.a]); break;
+            case OpCode::LOAD:   built[i] = arena->make<IdNode>(node.a); break;
+            case OpCode::ERROR:  built[i] = arena->make<ErrorNode>(strings[node.a]); break;
+            case OpCode::NEG:
+            case OpCode::NOT:
+                built[i] = arena->make<UnaryOpNode>(operators[static_cast<size_t>(toOperator(node.op))], built[node.a]);
+                break;
+            case OpCode::INVALID_UNARY:
+                built[i] = arena->make<UnaryOpNode>(strings[node.b], built[node.a]);
+                break;
+            case OpCode::ASSIGN:
+                built[i] = arena->make<BinaryOpNode>("=", arena->make<IdNode>(node.a), built[node.b]);
+                break;
+            case OpCode::INVALID_ASSIGN:
+                built[i] = arena->make<BinaryOpNode>("=", built[node.a], built[node.b]);
+                break;
+            case OpCode::INVALID_BINARY:
+                built[i] = arena->make<BinaryOpNode>("?", built[node.a], built[node.b]);
+                break;
+            case OpCode::SUM:
+            case OpCode::PRODUCT: {
+                std::vector<std::shared_ptr<ASTNode>> chain;
+                for (uint32_t k = 0; k < node.b; k++) chain.push_back(built[chains[node.a + k]]);
+                built[i] = arena->make<NaryOpNode>(operators[static_cast<size_t>(toOperator(node.op))], std::move(chain));
+                break;
+            }
+            default:
+                built[i] = arena->make<BinaryOpNode>(operators[static_cast<size_t>(toOperator(node.op))],
+                                                     built[node.a], built[node.b]);
+                break;
+        }
+    }
+    return std::shared_ptr<ASTNode>(arena, built[roots[statement]].get());
+}
+
+
+std::string AST::FlatAST::dump() const {
+    std::ostringstream out;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        const FlatNode& node = nodes[i];
+        out << i << ": " << name(node.op);
+        switch (node.op) {
+            case OpCode::INT:    out << " " << integers[node.a]; break;
+            case OpCode::FLOAT:  out << " " << floats[node.a]; break;
+            case OpCode::STRING: out << " '" << strings[node.a] << "'"; break;
+            case OpCode::LOAD:   out << " " << Utils::SymbolTable::instance().name(node.a); break;
+            case OpCode::ERROR:  out << " " << strings[node.a]; break;
+            case OpCode::NEG:
+            case OpCode::NOT:    out << " " << node.a; break;
+            case OpCode::INVALID_UNARY: out << " " << strings[node.b] << " " << node.a; break;
+            case OpCode::ASSIGN: out << " " << Utils::SymbolTable::instance().name(node.a) << " " << node.b; break;
+            case OpCode::SUM:
+            case OpCode::PRODUCT:
+                for (uint32_t k = 0; k < node.b; k++) out << " " << chains[node.a + k];
+                break;
+            default:             out << " " << node.a << " " << node.b; break;
+        }
+        out << "\n";
+    }
+    return out.str();
+}
+
+
+const char* AST::FlatAST::name(OpCode op) {
+    static const std::array<const char*, 25> names = {
+        "INT", "FLOAT", "STRING", "LOAD", "ERROR", "NEG", "NOT",
+        "ADD", "SUB", "MUL", "DIV", "EQ", "NE", "LT", "LE", "GT", "GE",
+        "AND", "OR", "ASSIGN", "INVALID_UNARY", "INVALID_BINARY", "INVALID_ASSIGN",
+        "SUM", "PRODUCT"
+    };
+    return names[static_cast<size_t>(op)];
+}
+
+} // namespace DemoLang
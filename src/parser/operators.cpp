@@ -9,47 +9,97 @@
 
 namespace DemoLang {
 
-std::shared_ptr<ASTNode> ParserSpace::UnaryParser::handle() {
-    Token token = parser.current();
-    // Check if current token is a unary operator we handle
-    if (token.type == TokenType::OPERATOR && std::find(operators.begin(), operators.end(), token.value) != operators.end()) {
-        parser.advance(); // Consume the operator
-        auto operand = nextHandler->handle(); // Parse the operand (right-associative)
-        if (!operand) return std::make_shared<ErrorNode>("Expected expression after: " + token.value);
-        return std::make_shared<UnaryOpNode>(token.value, std::move(operand));
-    }
-    // Not a unary operator, pass to next handler
-    return nextHandler->handle();
-}
+std::shared_ptr<ASTNode> ParserSpace::Parser::parseExpression() {
+    // Precedence climbing driven by an explicit stack of pending constructs,
+    // so nesting is bounded by maxDepth rather than by the C++ stack
+    std::vector<Frame> frames;
+    frames.push_back({Frame::BINARY, 1});     // Lowest binding power, assignment
+    size_t groups = 0;
+    bool needOperand = true;
+    std::shared_ptr<ASTNode> value;
 
-
-std::shared_ptr<ASTNode> ParserSpace::BinaryParser::handle() {
-    auto left = nextHandler->handle();  // Parse left operand first
-    if (!left) return std::make_shared<ErrorNode>("Left part can not be parsed");
-    
-    // Process a chain of binary operations with same precedence (left-associative)
     while (true) {
-        Token token = parser.current();
-        // Check if current token is a binary operator we handle
-        if (token.type != TokenType::OPERATOR
-            || std::find(operators.begin(), operators.end(), token.value) == operators.end())
-            break;
-        
-        std::string op = token.value;
-        parser.advance(); // Consume the operator
-        auto right = nextHandler->handle();  // Parse right operand
-        if (!right) return std::make_shared<ErrorNode>("Expected right operand for: " + op);
-
-        // Special validation for assignment operator
-        if (token.value == "=" && dynamic_cast<IdNode*>(left.get()) == nullptr)
-            return std::make_shared<ErrorNode>("Left side of assignment must be an identifier");
-        
-        // Create binary operation node and continue for chaining
-        left = std::make_shared<BinaryOpNode>(op, std::move(left), std::move(right));
-        if (token.value == "=") break;  // Assignment is right-associative and doesn't chain
+        if (needOperand) {
+            // An operand is an optional unary operator and a primary, unary operators do not nest
+            Operator op = currentOperator();
+            if (op != Operator::NONE && unaryOperator[static_cast<size_t>(op)]) {
+                advance(); // Consume the operator
+                frames.push_back({Frame::UNARY, 0, op});
+            }
+            if (currentOperator() != Operator::LEFT_PAREN) {
+                value = parsePrimary();
+                needOperand = false;
+                continue;
+            }
+
+            // Parenthesized expression, parsed as a new expression inside a group
+            advance();
+            if (current().type == TokenType::END) {
+                value = make<ErrorNode>("Unexpected end of input, expected closing parenthesis");
+                needOperand = false;
+                continue;
+            }
+            if (++groups > maxDepth) throw std::runtime_error("Maximum nesting depth exceeded");
+            frames.push_back({Frame::GROUP});
+            frames.push_back({Frame::BINARY, 1});
+            continue;
+        }
+
+        // A value is complete, hand it to the innermost pending construct
+        Frame& frame = frames.back();
+        if (frame.kind == Frame::UNARY) {
+            value = make<UnaryOpNode>(operators[static_cast<size_t>(frame.op)], std::move(value));
+            frames.pop_back();
+            continue;
+        }
+        if (frame.kind == Frame::GROUP) {
+            frames.pop_back();
+            groups--;
+            // Check for closing parenthesis
+            if (!match(TokenType::OPERATOR, ")")) {
+                // Provide more specific error message based on current token
+                if (current().type == TokenType::END)
+                    value = make<ErrorNode>("Unexpected end of input, expected closing parenthesis");
+                else
+                    value = make<ErrorNode>("Expected closing parenthesis, found: " + std::string(current().value));
+            }
+            continue;
+        }
+
+        // Binary: the value is either the right operand of a pending operator or the first operand
+        if (frame.op != Operator::NONE) {
+            Operator op = frame.op;
+            frame.op = Operator::NONE;
+            // Special validation for assignment operator
+            if (op == Operator::ASSIGN && dynamic_cast<IdNode*>(frame.left.get()) == nullptr) {
+                value = make<ErrorNode>("Left side of assignment must be an identifier");
+                frames.pop_back();
+                if (frames.empty()) return value;
+                continue;
+            }
+            value = make<BinaryOpNode>(operators[static_cast<size_t>(op)], std::move(frame.left), std::move(value));
+            if (op == Operator::ASSIGN) {  // Assignment doesn't chain
+                frames.pop_back();
+                if (frames.empty()) return value;
+                continue;
+            }
+        }
+
+        // Take the next operator binding at least as tightly as the frame allows
+        Operator op = currentOperator();
+        uint8_t precedence = op == Operator::NONE ? 0 : binaryPrecedence[static_cast<size_t>(op)];
+        if (precedence == 0 || precedence < frame.minPrecedence) {
+            frames.pop_back();
+            if (frames.empty()) return value;
+            continue;
+        }
+        advance(); // Consume the operator
+        frame.op = op;
+        frame.left = std::move(value);
+        // Operands only take tighter operators, which makes the operator left-associative
+        frames.push_back({Frame::BINARY, static_cast<uint8_t>(precedence + 1)});
+        needOperand = true;
     }
-    
-    return left;
 }
 
-} // namespace DemoLang
\ No newline at end of file
+} // namespace DemoLang
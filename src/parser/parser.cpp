@@ -6,13 +6,14 @@
 #include "ast.hpp"
 #include "parser.hpp"
 #include "utils.hpp"
+#include <algorithm>
 
 
 namespace DemoLang {
 
-bool ParserSpace::Parser::match(TokenType type, const std::string& value) {
+bool ParserSpace::Parser::match(TokenType type, std::string_view value) {
     // Check if current token matches expected type and value
-    Token curr = current();
+    TokenView curr = current();
     bool matches = (curr.type == type && curr.value == value);
     if (matches) advance(); // Move to next token if match found
     return matches;
@@ -20,40 +21,67 @@ bool ParserSpace::Parser::match(TokenType type, const std::string& value) {
 
 
 std::shared_ptr<ASTNode> ParserSpace::Parser::parse(const std::vector<Token> &tokens) {
-    // Initialize parser state
-    this->tokens = tokens;
-    this->current_pos = 0;
+    // Owning tokens are laid out into a stream kept by the parser
+    owned = TokenStream(tokens);
+    return parse(owned);
+}
+
+
+Generator<TokenView> ParserSpace::Parser::replay(const TokenStream &tokens) {
+    for (size_t i = 0; i < tokens.size(); i++) co_yield tokens[i];
+}
+
+
+std::shared_ptr<ASTNode> ParserSpace::Parser::parse(const TokenStream &tokens) {
+    // The stream is referenced rather than copied
+    return parse(replay(tokens));
+}
+
+
+std::shared_ptr<ASTNode> ParserSpace::Parser::parse(Generator<TokenView> tokens) {
+    // Every node of this tree goes into one arena
+    this->arena = std::make_shared<ASTArena>();
+    std::shared_ptr<ASTNode> ast = parseRoot(std::move(tokens));
+    this->arena.reset();
+    return ast;
+}
+
+
+std::shared_ptr<ASTNode> ParserSpace::Parser::parseRoot(Generator<TokenView> tokens) {
+    // Initialize parser state by pulling the first token
+    this->source = std::move(tokens);
+    this->head = TokenView{TokenType::END, ""};
     
+    std::shared_ptr<ASTNode> ast;
     try {
-        // Start parsing from expression level
-        return parseExpression();
+        if (source.next()) head = source.value();
+        // Start parsing from expression level, the root shares ownership of the arena
+        ast = std::shared_ptr<ASTNode>(arena, parseExpression().get());
     } catch (const std::exception& e) {
         // Return error node if parsing fails
-        return std::make_shared<ErrorNode>(e.what());
+        ast = std::make_shared<ErrorNode>(e.what());
     }
+    // Do not keep referring to tokens the caller may release
+    this->source = Generator<TokenView>();
+    this->head = TokenView{TokenType::END, ""};
+    return ast;
 }
 
-std::shared_ptr<ASTNode> ParserSpace::Parser::parseExpression() {
-    // Create operator precedence chain using chain of responsibility pattern
-    // Operators are added in order of precedence (lowest to highest)
-    Utils::Chain<ASTNode> chain;
-    // Assignment operators (lowest precedence)
-    chain.addHandler(std::make_shared<BinaryParser>(*this, std::vector<std::string>{"="}));
-    // Logical operators
-    chain.addHandler(std::make_shared<BinaryParser>(*this, std::vector<std::string>{"&", "|"}));
-    // Equality operators
-    chain.addHandler(std::make_shared<BinaryParser>(*this, std::vector<std::string>{"==", "!="}));
-    // Relational operators
-    chain.addHandler(std::make_shared<BinaryParser>(*this, std::vector<std::string>{"<", "<=", ">", ">="}));
-    // Additive operators
-    chain.addHandler(std::make_shared<BinaryParser>(*this, std::vector<std::string>{"+", "-"}));
-    // Multiplicative operators
-    chain.addHandler(std::make_shared<BinaryParser>(*this, std::vector<std::string>{"*", "/"}));
-    // Unary operators (highest precedence)
-    chain.addHandler(std::make_shared<UnaryParser>(*this, std::vector<std::string>{"!", "-"}));
-    // Primary expressions (literals, identifiers)
-    chain.addHandler(std::make_shared<PrimaryParser>(*this));
-    return chain.execute();
+
+std::shared_ptr<ASTNode> ParserSpace::Parser::parseSource(std::string_view source) {
+    std::string key(source);
+    if (auto cached = cache.find(key)) return cached;
+
+    // A cached tree keeps its arena, so the arena is sized to the source
+    // instead of taking a full block for a short line
+    size_t blockSize = std::clamp<size_t>(source.size() * 64, 256, Utils::Arena::defaultBlockSize);
+    this->arena = std::make_shared<ASTArena>(blockSize);
+    std::shared_ptr<ASTNode> ast = parseRoot(LexerSpace::Lexer::instance().tokens(source));
+    size_t bytes = arena->bytesReserved();
+    this->arena.reset();
+
+    cache.insert(key, ast, bytes);
+    return ast;
 }
 
-} // namespace DemoLang
\ No newline at end of file
+} // namespace DemoLang
@@ -0,0 +1,144 @@
+/**
+ * @file src/parser/program.cpp
+ * @brief Parse whole scripts into statement lists.
+**/
+
+#include "parser.hpp"
+
+using namespace DemoLang;
+using namespace DemoLang::LexerSpace;
+using namespace DemoLang::ParserSpace;
+
+
+namespace DemoLang {
+
+namespace {
+
+const char* const blanks = " \t\r\n";
+
+bool isBlank(std::string_view line) {
+    return line.find_first_not_of(blanks) == std::string_view::npos;
+}
+
+std::string_view trimRight(std::string_view line) {
+    return line.substr(0, line.find_last_not_of(blanks) + 1);
+}
+
+std::string_view trim(std::string_view line) {
+    line = trimRight(line);
+    return line.substr(line.find_first_not_of(blanks));
+}
+
+// How a line changes the parenthesis depth, and whether lexing it failed
+struct Nesting {
+    long depth = 0;
+    bool error = false;
+};
+
+Nesting nesting(std::string_view line) {
+    Nesting result;
+    // Lines without parentheses are only lexed once, when they are parsed
+    if (line.find_first_of("()") == std::string_view::npos) return result;
+    Generator<TokenView> tokens = Lexer::instance().tokens(line);
+    while (tokens.next()) {
+        const TokenView& token = tokens.value();
+        if (token.type == TokenType::ERROR) result.error = true;
+        else if (token.type == TokenType::OPERATOR && token.value == "(") result.depth++;
+        else if (token.type == TokenType::OPERATOR && token.value == ")") result.depth--;
+    }
+    return result;
+}
+
+// Tokens of the lines of one statement, as a single sequence ending with END
+Generator<TokenView> statementTokens(std::vector<std::string_view> lines) {
+    for (std::string_view line : lines) {
+        Generator<TokenView> tokens = Lexer::instance().tokens(line);
+        while (tokens.next()) {
+            TokenView token = tokens.value();
+            if (token.type == TokenType::END) break;
+            co_yield token;
+            if (token.type == TokenType::ERROR) {
+                // Tokenizing stops at the first error, the message must outlive the parse
+                co_yield TokenView{TokenType::END, ""};
+                co_return;
+            }
+        }
+    }
+    co_yield TokenView{TokenType::END, ""};
+}
+
+// Whether parsing left an error anywhere in a tree, visited without recursion
+bool containsError(ASTNode* root) {
+    std::vector<ASTNode*> pending = {root};
+    while (!pending.empty()) {
+        ASTNode* node = pending.back();
+        pending.pop_back();
+        if (dynamic_cast<ErrorNode*>(node)) return true;
+        if (auto* unary = dynamic_cast<UnaryOpNode*>(node)) {
+            pending.push_back(unary->getOperand());
+        } else if (auto* binary = dynamic_cast<BinaryOpNode*>(node)) {
+            pending.push_back(binary->getLeft());
+            pending.push_back(binary->getRight());
+        } else if (auto* nary = dynamic_cast<NaryOpNode*>(node)) {
+            for (size_t i = 0; i < nary->size(); i++) pending.push_back(nary->getOperand(i));
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+
+Program ParserSpace::Parser::parseProgram(std::string_view source) {
+    // Split into lines, the last one may lack a line break
+    std::vector<std::string_view> lines;
+    for (size_t begin = 0; begin < source.size();) {
+        size_t end = source.find('\n', begin);
+        if (end == std::string_view::npos) end = source.size();
+        lines.push_back(source.substr(begin, end - begin));
+        begin = end + 1;
+    }
+
+    Program program;
+    // Statements that span lines share one arena
+    std::shared_ptr<ASTArena> spanning;
+    for (size_t i = 0; i < lines.size(); i++) {
+        // Skip empty lines
+        if (isBlank(lines[i])) continue;
+        size_t first = i;
+
+        Nesting open = nesting(trimRight(lines[i]));
+        if (open.error || open.depth <= 0) {
+            // A one-line statement is the same as a line on its own, so it goes through the cache
+            program.add(parseSource(lines[i]), first + 1);
+            continue;
+        }
+
+        // Collect lines until the parentheses close, a line fails to lex or the input ends
+        std::vector<std::string_view> parts = {trimRight(lines[i])};
+        while (!open.error && open.depth > 0 && i + 1 < lines.size()) {
+            if (isBlank(lines[++i])) continue;
+            parts.push_back(trim(lines[i]));
+            Nesting next = nesting(parts.back());
+            open.depth += next.depth;
+            open.error = next.error;
+        }
+        std::shared_ptr<ASTNode> statement;
+        if (!open.error && open.depth <= 0) {
+            if (!spanning) spanning = std::make_shared<ASTArena>();
+            this->arena = spanning;
+            statement = parseRoot(statementTokens(std::move(parts)));
+            this->arena.reset();
+        }
+        if (!statement || containsError(statement.get())) {
+            // Parentheses never closed or the joined lines do not parse, so the first
+            // line stands alone as it would without continuation and the next one is a new statement
+            statement = parseSource(lines[first]);
+            i = first;
+        }
+        program.add(std::move(statement), first + 1);
+    }
+    return program;
+}
+
+} // namespace DemoLang
@@ -8,47 +8,6 @@
 
 namespace DemoLang {
 
-/**
- * @brief Flyweight factory for AST nodes
- */
-class ASTFlyweight {
-private:
-    static Utils::FlyweightFactory<std::string, ASTNode>& factory() {
-        return Utils::FlyweightFactory<std::string, ASTNode>::instance();
-    }
-    
-public:
-    static std::shared_ptr<ASTNode> getIdNode(const std::string& name) {
-        return factory().getFlyweight("id:" + name, [&name]() {
-            return std::make_shared<IdNode>(name);
-        });
-    }
-    
-    static std::shared_ptr<ASTNode> getIntNode(long long value) {
-        std::string key = "int:" + std::to_string(value);
-        return factory().getFlyweight(key, [value]() {
-            return std::make_shared<IntNode>(value);
-        });
-    }
-    
-    static std::shared_ptr<ASTNode> getFloatNode(long double value) {
-        std::string key = "float:" + std::to_string(value);
-        return factory().getFlyweight(key, [value]() {
-            return std::make_shared<FloatNode>(value);
-        });
-    }
-    
-    static std::shared_ptr<ASTNode> getStringNode(const std::string& value) {
-        std::string key = "string:" + value;
-        return factory().getFlyweight(key, [&value]() {
-            return std::make_shared<StringNode>(value);
-        });
-    }
-    
-    static void clearCache() { factory().clear(); }
-    static size_t cacheSize() { return factory().size(); }
-};
-
 // AST Node Factory using Utils Factory template
 class ASTNodeFactory : public Utils::Factory<TokenType, ASTNode>, public Utils::Singleton<ASTNodeFactory> {
 private:
@@ -67,7 +26,7 @@ private:
     }
 
 public:
-    std::shared_ptr<ASTNode> createNode(const Token& token, ParserSpace::Parser& parser) {
+    std::shared_ptr<ASTNode> createNode(const TokenView& token) {
         initializeCreators();
         
         switch (token.type) {
@@ -78,16 +37,16 @@ public:
             case TokenType::FLOAT_LITERAL:
                 return createFloatNode(token);
             case TokenType::IDENTIFIER:
-                return ASTFlyweight::getIdNode(token.value);
+                // The lexer already interned the name
+                if (token.hasLiteral) return ParserSpace::ASTFlyweight::getIdNode(token.literal.symbol);
+                return ParserSpace::ASTFlyweight::getIdNode(token.value);
             case TokenType::OPERATOR:
-                if (token.value == "(") {
-                    return createParenthesizedNode(token, parser);
-                }
-                return std::make_shared<ErrorNode>("Unexpected operator: " + token.value);
+                // Parentheses are handled by the parser
+                return std::make_shared<ErrorNode>("Unexpected operator: " + std::string(token.value));
             case TokenType::ERROR:
-                return createErrorNode(token.value);
+                return createErrorNode(std::string(token.value));
             default:
-                return std::make_shared<ErrorNode>("Unexpected token: " + token.value);
+                return std::make_shared<ErrorNode>("Unexpected token: " + std::string(token.value));
         }
     }
     
@@ -96,75 +55,33 @@ public:
     }
     
 private:
-    std::shared_ptr<ASTNode> createStringNode(const Token& token) {
+    std::shared_ptr<ASTNode> createStringNode(const TokenView& token) {
         if (token.value.size() >= 2) {
             char first = token.value.front(), last = token.value.back();
             if ((first == '\"' && last == '\"') || (first == '\'' && last == '\''))
-                return ASTFlyweight::getStringNode(token.value.substr(1, token.value.size() - 2));
-        }
-        return std::make_shared<ErrorNode>("Invalid string: " + token.value);
-    }
-    
-    std::shared_ptr<ASTNode> createIntNode(const Token& token) {
-        try {
-            long long val = std::stoll(token.value);
-            return ASTFlyweight::getIntNode(static_cast<long long>(val));
-        } catch (...) { 
-            return std::make_shared<ErrorNode>("Invalid integer: " + token.value); 
+                return ParserSpace::ASTFlyweight::getStringNode(token.value.substr(1, token.value.size() - 2));
         }
+        return std::make_shared<ErrorNode>("Invalid string: " + std::string(token.value));
     }
     
-    std::shared_ptr<ASTNode> createFloatNode(const Token& token) {
-        try {
-            char* end;
-            double val = std::strtold(token.value.c_str(), &end);
-            if (end != token.value.c_str() + token.value.length() || errno == ERANGE)
-                return std::make_shared<ErrorNode>("Invalid float");
-            return ASTFlyweight::getFloatNode(static_cast<long double>(val));
-        } catch (...) { 
-            return std::make_shared<ErrorNode>("Invalid float: " + token.value); 
-        }
+    std::shared_ptr<ASTNode> createIntNode(const TokenView& token) {
+        // The lexer already parsed the value, the text is only needed for errors
+        if (!token.hasLiteral) return std::make_shared<ErrorNode>("Invalid integer: " + std::string(token.value));
+        return ParserSpace::ASTFlyweight::getIntNode(token.literal.integer);
     }
     
-    std::shared_ptr<ASTNode> createParenthesizedNode(const Token& token, ParserSpace::Parser& parser) {
-        // Advance past the opening parenthesis
-        parser.advance();
-        
-        // Check if we've reached end of input prematurely
-        if (parser.current().type == TokenType::END) {
-            return std::make_shared<ErrorNode>("Unexpected end of input, expected closing parenthesis");
-        }
-        
-        auto expr = parser.parseExpression();
-        if (!expr) {
-            // Check if we have an empty expression (immediately followed by ')')
-            if (parser.current().type == TokenType::OPERATOR && parser.current().value == ")") {
-                return std::make_shared<ErrorNode>("Empty parentheses are not allowed");
-            }
-            return std::make_shared<ErrorNode>("Invalid expression in parentheses");
-        }        
-        
-        // Check for closing parenthesis
-        if (!parser.match(TokenType::OPERATOR, ")")) {
-            // Provide more specific error message based on current token
-            if (parser.current().type == TokenType::END) {
-                return std::make_shared<ErrorNode>("Unexpected end of input, expected closing parenthesis");
-            } else {
-                return std::make_shared<ErrorNode>("Expected closing parenthesis, found: " + parser.current().value);
-            }
-        }
-        return expr;
+    std::shared_ptr<ASTNode> createFloatNode(const TokenView& token) {
+        // The lexer already parsed the value, the text is only needed for errors
+        if (!token.hasLiteral) return std::make_shared<ErrorNode>("Invalid float");
+        return ParserSpace::ASTFlyweight::getFloatNode(token.literal.floating);
     }
 };
 
-std::shared_ptr<ASTNode> ParserSpace::PrimaryParser::handle() {
-    Token token = parser.current();
-    // Don't advance here for '(' tokens, let createParenthesizedNode handle it
-    if (token.type == TokenType::OPERATOR && token.value == "(") {
-        return ASTNodeFactory::instance().createNode(token, parser);
-    }
-    parser.advance();
-    return ASTNodeFactory::instance().createNode(token, parser);
+std::shared_ptr<ASTNode> ParserSpace::Parser::parsePrimary() {
+    TokenView token = current();
+    advance();
+    // Leaves may be flyweights shared with other trees, the arena keeps them alive
+    return adopt(ASTNodeFactory::instance().createNode(token));
 }
 
 } // namespace DemoLang
\ No newline at end of file
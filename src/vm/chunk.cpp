@@ -0,0 +1,107 @@
+/**
+ * @file src/vm/chunk.cpp
+ * @brief Bytecode disassembler.
+**/
+
+#include "vm.hpp"
+#include <iomanip>
+#include <sstream>
+
+
+namespace DemoLang {
+
+namespace {
+
+// Bytes of operands following an opcode
+size_t operandBytes(VMSpace::Opcode op) {
+    switch (op) {
+        case VMSpace::Opcode::CONSTANT:
+        case VMSpace::Opcode::LOAD:
+        case VMSpace::Opcode::STORE:
+        case VMSpace::Opcode::FAIL:     return 4;
+        case VMSpace::Opcode::UNARY:
+        case VMSpace::Opcode::BINARY:   return 1;
+        case VMSpace::Opcode::CHAIN:    return 5;
+        default:                        return 0;
+    }
+}
+
+} // namespace
+
+
+const char* VMSpace::Chunk::name(Opcode op) {
+    switch (op) {
+        case Opcode::CONSTANT:  return "CONSTANT";
+        case Opcode::LOAD:      return "LOAD";
+        case Opcode::STORE:     return "STORE";
+        case Opcode::POP:       return "POP";
+        case Opcode::NEG:       return "NEG";
+        case Opcode::NOT:       return "NOT";
+        case Opcode::UNARY:     return "UNARY";
+        case Opcode::ADD:       return "ADD";
+        case Opcode::SUB:       return "SUB";
+        case Opcode::MUL:       return "MUL";
+        case Opcode::DIV:       return "DIV";
+        case Opcode::EQ:        return "EQ";
+        case Opcode::NE:        return "NE";
+        case Opcode::LT:        return "LT";
+        case Opcode::LE:        return "LE";
+        case Opcode::GT:        return "GT";
+        case Opcode::GE:        return "GE";
+        case Opcode::AND:       return "AND";
+        case Opcode::OR:        return "OR";
+        case Opcode::BINARY:    return "BINARY";
+        case Opcode::CHAIN:     return "CHAIN";
+        case Opcode::FAIL:      return "FAIL";
+        case Opcode::RETURN:    return "RETURN";
+        default:                return "UNKNOWN";
+    }
+}
+
+
+size_t VMSpace::Chunk::instructionCount() const {
+    size_t count = 0;
+    for (size_t offset = 0; offset < code.size(); offset += 1 + operandBytes(static_cast<Opcode>(code[offset]))) count++;
+    return count;
+}
+
+
+std::string VMSpace::Chunk::disassemble() const {
+    std::ostringstream out;
+    auto word = [this](size_t at) {
+        uint32_t value = 0;
+        for (int i = 3; i >= 0; i--) value = value << 8 | code[at + i];
+        return value;
+    };
+
+    for (size_t offset = 0; offset < code.size();) {
+        Opcode op = static_cast<Opcode>(code[offset]);
+        out << std::setw(4) << std::setfill('0') << offset << ' ' << name(op);
+        size_t at = offset + 1;
+        switch (op) {
+            case Opcode::CONSTANT:
+            case Opcode::FAIL:
+                // Constants are shown the way they would be printed
+                out << ' ' << word(at) << " ; " << Interpreter::render(constants[word(at)]);
+                break;
+            case Opcode::LOAD:
+            case Opcode::STORE:
+                out << ' ' << word(at) << " ; " << SymbolTable::instance().name(word(at));
+                break;
+            case Opcode::UNARY:
+            case Opcode::BINARY:
+                out << ' ' << static_cast<int>(code[at]);
+                break;
+            case Opcode::CHAIN:
+                out << ' ' << static_cast<int>(code[at]) << ' ' << word(at + 1);
+                break;
+            default:
+                break;
+        }
+        out << '\n';
+        offset = at + operandBytes(op);
+    }
+    return out.str();
+}
+
+} // namespace DemoLang
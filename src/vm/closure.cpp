@@ -0,0 +1,290 @@
+/**
+ * @file src/vm/closure.cpp
+ * @brief Closure compiler and engine.
+**/
+
+#include "closure.hpp"
+#include <algorithm>
+
+
+namespace DemoLang {
+
+namespace {
+
+using Closure = VMSpace::Closure;
+using Call = Closure::Call;
+
+// Calls of the closures, each knows its operator and the shape of its operands
+
+Value literal(const Closure& self, Closure::Context&) {
+    return self.constant;
+}
+
+Value variable(const Closure& self, Closure::Context& context) {
+    return context.env.has(self.symbol) ? context.env.get(self.symbol)
+        : Value::makeException("Undefined variable: " + SymbolTable::instance().name(self.symbol));
+}
+
+Value assign(const Closure& self, Closure::Context& context) {
+    Value value = (*self.operands[0])(context);
+    context.env.set(self.symbol, value);
+    return value;
+}
+
+Value invalidAssign(const Closure& self, Closure::Context& context) {
+    // Both operands are still computed for their side effects
+    (*self.operands[0])(context);
+    (*self.operands[1])(context);
+    return self.constant;
+}
+
+template <Operator op>
+Value unary(const Closure& self, Closure::Context& context) {
+    return UnaryOperatorFactory::execute(op, (*self.operands[0])(context));
+}
+
+Value unaryAny(const Closure& self, Closure::Context& context) {
+    return UnaryOperatorFactory::execute(self.op, (*self.operands[0])(context));
+}
+
+template <Operator op>
+Value binary(const Closure& self, Closure::Context& context) {
+    Value left = (*self.operands[0])(context);
+    Value right = (*self.operands[1])(context);
+    return BinOperatorFactory::execute(op, left, right);
+}
+
+// A literal right operand is read in place rather than called
+template <Operator op>
+Value binaryConstant(const Closure& self, Closure::Context& context) {
+    return BinOperatorFactory::execute(op, (*self.operands[0])(context), self.operands[1]->constant);
+}
+
+Value binaryAny(const Closure& self, Closure::Context& context) {
+    Value left = (*self.operands[0])(context);
+    Value right = (*self.operands[1])(context);
+    return BinOperatorFactory::execute(self.op, left, right);
+}
+
+// Operands are collected and combined at once, so strings are joined in one allocation
+Value chain(const Closure& self, Closure::Context& context) {
+    std::vector<Value>& pending = context.pending;
+    size_t base = pending.size();
+    for (uint32_t i = 0; i < self.count; i++) pending.push_back((*self.operands[i])(context));
+    Value result = BinOperatorFactory::executeChain(self.op, pending.data() + base, self.count);
+    pending.resize(base);
+    return result;
+}
+
+template <Operator op>
+Call binaryFor(bool constantRight) {
+    return constantRight ? binaryConstant<op> : binary<op>;
+}
+
+Call binaryCall(Operator op, bool constantRight) {
+    switch (op) {
+        case Operator::PLUS:            return binaryFor<Operator::PLUS>(constantRight);
+        case Operator::MINUS:           return binaryFor<Operator::MINUS>(constantRight);
+        case Operator::MULTIPLY:        return binaryFor<Operator::MULTIPLY>(constantRight);
+        case Operator::DIVIDE:          return binaryFor<Operator::DIVIDE>(constantRight);
+        case Operator::EQUAL:           return binaryFor<Operator::EQUAL>(constantRight);
+        case Operator::NOT_EQUAL:       return binaryFor<Operator::NOT_EQUAL>(constantRight);
+        case Operator::LESS:            return binaryFor<Operator::LESS>(constantRight);
+        case Operator::LESS_EQUAL:      return binaryFor<Operator::LESS_EQUAL>(constantRight);
+        case Operator::GREATER:         return binaryFor<Operator::GREATER>(constantRight);
+        case Operator::GREATER_EQUAL:   return binaryFor<Operator::GREATER_EQUAL>(constantRight);
+        case Operator::AND:             return binaryFor<Operator::AND>(constantRight);
+        case Operator::OR:              return binaryFor<Operator::OR>(constantRight);
+        default:                        return binaryAny;
+    }
+}
+
+} // namespace
+
+
+VMSpace::ClosureProgram VMSpace::ClosureCompiler::compile(ASTNode& root) {
+    program = ClosureProgram();
+    program.maxDepth = maxDepth;
+    built.clear();
+    firsts.clear();
+    targets.clear();
+    // Every node is built, the engine stops at the maximum depth when it runs them
+    walk(root, SIZE_MAX);
+    program.depth = deepest;
+
+    // Closures no longer move, so operands can point at them
+    program.links.reserve(targets.size());
+    for (uint32_t target : targets) program.links.push_back(&program.closures[target]);
+    for (size_t i = 0; i < program.closures.size(); i++) program.closures[i].operands = program.links.data() + firsts[i];
+    return std::move(program);
+}
+
+
+void VMSpace::ClosureCompiler::add(Closure closure, size_t operands) {
+    firsts.push_back(static_cast<uint32_t>(targets.size()));
+    targets.insert(targets.end(), built.end() - operands, built.end());
+    built.resize(built.size() - operands);
+    closure.count = static_cast<uint32_t>(operands);
+    built.push_back(static_cast<uint32_t>(program.closures.size()));
+    program.closures.push_back(std::move(closure));
+}
+
+
+void VMSpace::ClosureCompiler::constant(Value value) {
+    Closure closure;
+    closure.call = literal;
+    closure.constant = std::move(value);
+    add(std::move(closure), 0);
+}
+
+
+void VMSpace::ClosureCompiler::visit(UnaryOpNode& node) {
+    if (schedule(node)) return;
+    Closure closure;
+    closure.kind = Closure::Kind::UNARY;
+    closure.op = operatorOf(node.getOp());
+    closure.call = closure.op == Operator::MINUS ? unary<Operator::MINUS>
+                 : closure.op == Operator::NOT ? unary<Operator::NOT> : unaryAny;
+    add(std::move(closure), 1);
+}
+
+
+void VMSpace::ClosureCompiler::visit(BinaryOpNode& node) {
+    if (schedule(node)) return;
+    Operator op = operatorOf(node.getOp());
+    Closure closure;
+    closure.op = op;
+    if (auto* target = assignTarget(node)) {
+        closure.kind = Closure::Kind::ASSIGN;
+        closure.symbol = target->getSymbol();
+        closure.call = assign;
+        return add(std::move(closure), 1);
+    }
+    if (op == Operator::ASSIGN) {
+        closure.kind = Closure::Kind::INVALID_ASSIGN;
+        closure.constant = Value::makeException("Left side of assignment must be an identifier");
+        closure.call = invalidAssign;
+        return add(std::move(closure), 2);
+    }
+    closure.kind = Closure::Kind::BINARY;
+    closure.call = binaryCall(op, program.closures[built.back()].kind == Closure::Kind::CONSTANT);
+    add(std::move(closure), 2);
+}
+
+
+void VMSpace::ClosureCompiler::visit(NaryOpNode& node) {
+    if (schedule(node)) return;
+    Closure closure;
+    closure.kind = Closure::Kind::CHAIN;
+    closure.op = operatorOf(node.getOp());
+    if (node.size() == 0) {
+        // Known without running anything
+        closure.constant = BinOperatorFactory::executeChain(closure.op, {});
+        closure.call = literal;
+    } else {
+        closure.call = chain;
+    }
+    add(std::move(closure), node.size());
+}
+
+
+void VMSpace::ClosureCompiler::visit(IdNode& node) {
+    Closure closure;
+    closure.kind = Closure::Kind::VARIABLE;
+    closure.symbol = node.getSymbol();
+    closure.call = variable;
+    add(std::move(closure), 0);
+}
+
+void VMSpace::ClosureCompiler::visit(IntNode& node) {
+    constant(Value::makeInteger(node.getValue()));
+}
+
+void VMSpace::ClosureCompiler::visit(FloatNode& node) {
+    constant(Value::makeFloat(node.getValue()));
+}
+
+void VMSpace::ClosureCompiler::visit(StringNode& node) {
+    constant(Value::makeString(node.getValue()));
+}
+
+void VMSpace::ClosureCompiler::visit(ErrorNode& node) {
+    constant(Value::makeException(node.getMessage()));
+}
+
+
+std::string VMSpace::ClosureEngine::interpret(const ClosureProgram& program) {
+    return Interpreter::render(run(program));
+}
+
+
+std::string VMSpace::ClosureEngine::interpret(const std::shared_ptr<ASTNode>& node) {
+    if (!node) return Interpreter::render(Value::makeException("Null AST Node"));
+    return interpret(ClosureCompiler().compile(*node));
+}
+
+
+Value VMSpace::ClosureEngine::run(const ClosureProgram& program) {
+    if (program.empty()) return Value();
+    if (program.getDepth() <= std::min(recursionLimit, program.getMaxDepth())) {
+        Closure::Context context{env, pending};
+        return program.root()(context);
+    }
+    return walk(program);
+}
+
+
+Value VMSpace::ClosureEngine::walk(const ClosureProgram& program) {
+    tasks.assign(1, Task{&program.root(), 1, false});
+    values.clear();
+    Closure::Context context{env, pending};
+
+    // Same order as Interpreter::evaluate, nodes without operands are called directly
+    while (!tasks.empty()) {
+        Task task = tasks.back();
+        tasks.pop_back();
+        if (task.depth > program.getMaxDepth()) {
+            tasks.clear();
+            values.clear();
+            return Value::makeException("Maximum evaluation depth exceeded");
+        }
+        const Closure& closure = *task.closure;
+        if (closure.count == 0) {
+            values.push_back(closure(context));
+            continue;
+        }
+        if (!task.combine) {
+            tasks.push_back({&closure, task.depth, true});
+            for (uint32_t i = closure.count; i-- > 0;) tasks.push_back({closure.operands[i], task.depth + 1, false});
+            continue;
+        }
+
+        Value* operands = values.data() + values.size() - closure.count;
+        Value result;
+        switch (closure.kind) {
+            case Closure::Kind::ASSIGN:
+                env.set(closure.symbol, operands[0]);
+                result = std::move(operands[0]);
+                break;
+            case Closure::Kind::INVALID_ASSIGN:
+                result = closure.constant;
+                break;
+            case Closure::Kind::UNARY:
+                result = UnaryOperatorFactory::execute(closure.op, operands[0]);
+                break;
+            case Closure::Kind::BINARY:
+                result = BinOperatorFactory::execute(closure.op, operands[0], operands[1]);
+                break;
+            default:
+                result = BinOperatorFactory::executeChain(closure.op, operands, closure.count);
+                break;
+        }
+        values.resize(values.size() - closure.count);
+        values.push_back(std::move(result));
+    }
+    Value result = std::move(values.back());
+    values.clear();
+    return result;
+}
+
+} // namespace DemoLang
@@ -0,0 +1,200 @@
+/**
+ * @file src/vm/compiler.cpp
+ * @brief Tree walk shared by the compilers, and the compiler from pointer trees to bytecode.
+**/
+
+#include "vm.hpp"
+#include <algorithm>
+#include <cstdio>
+
+
+namespace DemoLang {
+
+namespace {
+
+// Instruction of a binary operator, BINARY for one without its own
+VMSpace::Opcode binaryOpcode(Operator op) {
+    switch (op) {
+        case Operator::PLUS:            return VMSpace::Opcode::ADD;
+        case Operator::MINUS:           return VMSpace::Opcode::SUB;
+        case Operator::MULTIPLY:        return VMSpace::Opcode::MUL;
+        case Operator::DIVIDE:          return VMSpace::Opcode::DIV;
+        case Operator::EQUAL:           return VMSpace::Opcode::EQ;
+        case Operator::NOT_EQUAL:       return VMSpace::Opcode::NE;
+        case Operator::LESS:            return VMSpace::Opcode::LT;
+        case Operator::LESS_EQUAL:      return VMSpace::Opcode::LE;
+        case Operator::GREATER:         return VMSpace::Opcode::GT;
+        case Operator::GREATER_EQUAL:   return VMSpace::Opcode::GE;
+        case Operator::AND:             return VMSpace::Opcode::AND;
+        case Operator::OR:              return VMSpace::Opcode::OR;
+        default:                        return VMSpace::Opcode::BINARY;
+    }
+}
+
+} // namespace
+
+
+std::string VMSpace::constantKey(const Value& value) {
+    std::string key(1, static_cast<char>(value.getType()));
+    if (value.isInteger()) {
+        key += std::to_string(value.getInteger());
+    } else if (value.isFloat()) {
+        // The hexadecimal form is exact
+        char text[64];
+        std::snprintf(text, sizeof(text), "%La", value.getFloat());
+        key += text;
+    } else {
+        key += value.getString();
+    }
+    return key;
+}
+
+
+bool VMSpace::TreeCompiler::walk(ASTNode& root, size_t limit) {
+    tasks.assign(1, Task{&root, 1, false});
+    deepest = 0;
+    while (!tasks.empty()) {
+        task = tasks.back();
+        tasks.pop_back();
+        if (task.depth > limit) {
+            tasks.clear();
+            return false;
+        }
+        deepest = std::max<size_t>(deepest, task.depth);
+        task.node->accept(*this);
+    }
+    return true;
+}
+
+
+bool VMSpace::TreeCompiler::schedule(UnaryOpNode& node) {
+    if (task.combine) return false;
+    tasks.push_back({&node, task.depth, true});
+    tasks.push_back({node.getOperand(), task.depth + 1, false});
+    return true;
+}
+
+
+bool VMSpace::TreeCompiler::schedule(BinaryOpNode& node) {
+    if (task.combine) return false;
+    tasks.push_back({&node, task.depth, true});
+    tasks.push_back({node.getRight(), task.depth + 1, false});
+    // Reading the target has no effect, only the right operand is computed
+    if (!assignTarget(node)) tasks.push_back({node.getLeft(), task.depth + 1, false});
+    return true;
+}
+
+
+bool VMSpace::TreeCompiler::schedule(NaryOpNode& node) {
+    if (task.combine) return false;
+    tasks.push_back({&node, task.depth, true});
+    for (size_t i = node.size(); i-- > 0;) tasks.push_back({node.getOperand(i), task.depth + 1, false});
+    return true;
+}
+
+
+IdNode* VMSpace::TreeCompiler::assignTarget(BinaryOpNode& node) {
+    return operatorOf(node.getOp()) == Operator::ASSIGN ? dynamic_cast<IdNode*>(node.getLeft()) : nullptr;
+}
+
+
+VMSpace::Chunk VMSpace::Compiler::compile(ASTNode& root) {
+    chunk = Chunk();
+    pool.clear();
+    depth = 0;
+    if (walk(root, maxDepth)) {
+        chunk.emit(Opcode::RETURN);
+    } else {
+        chunk.emit(Opcode::FAIL);
+        chunk.emitWord(constant(Value::makeException("Maximum evaluation depth exceeded")));
+    }
+    return std::move(chunk);
+}
+
+
+uint32_t VMSpace::Compiler::constant(const Value& value) {
+    auto [it, added] = pool.try_emplace(constantKey(value), 0);
+    if (added) it->second = chunk.addConstant(value);
+    return it->second;
+}
+
+
+void VMSpace::Compiler::push(uint32_t index) {
+    chunk.emit(Opcode::CONSTANT);
+    chunk.emitWord(index);
+    chunk.reserveStack(++depth);
+}
+
+
+void VMSpace::Compiler::pop(size_t count) {
+    for (size_t i = 0; i < count; i++) chunk.emit(Opcode::POP);
+    depth -= count;
+}
+
+
+void VMSpace::Compiler::visit(UnaryOpNode& node) {
+    if (schedule(node)) return;
+    Operator op = operatorOf(node.getOp());
+    if (op == Operator::MINUS) {
+        chunk.emit(Opcode::NEG);
+    } else if (op == Operator::NOT) {
+        chunk.emit(Opcode::NOT);
+    } else {
+        chunk.emit(Opcode::UNARY);
+        chunk.emitByte(static_cast<uint8_t>(op));
+    }
+}
+
+
+void VMSpace::Compiler::visit(BinaryOpNode& node) {
+    if (schedule(node)) return;
+    Operator op = operatorOf(node.getOp());
+    if (auto* target = assignTarget(node)) {
+        chunk.emit(Opcode::STORE);
+        chunk.emitWord(target->getSymbol());
+    } else if (op == Operator::ASSIGN) {
+        pop(2);
+        push(constant(Value::makeException("Left side of assignment must be an identifier")));
+    } else {
+        Opcode opcode = binaryOpcode(op);
+        chunk.emit(opcode);
+        if (opcode == Opcode::BINARY) chunk.emitByte(static_cast<uint8_t>(op));
+        depth--;
+    }
+}
+
+
+void VMSpace::Compiler::visit(NaryOpNode& node) {
+    if (schedule(node)) return;
+    chunk.emit(Opcode::CHAIN);
+    chunk.emitByte(static_cast<uint8_t>(operatorOf(node.getOp())));
+    chunk.emitWord(static_cast<uint32_t>(node.size()));
+    // The result takes the place of the operands
+    depth = depth - node.size() + 1;
+    chunk.reserveStack(depth);
+}
+
+
+void VMSpace::Compiler::visit(IdNode& node) {
+    chunk.emit(Opcode::LOAD);
+    chunk.emitWord(node.getSymbol());
+    chunk.reserveStack(++depth);
+}
+
+void VMSpace::Compiler::visit(IntNode& node) {
+    push(constant(Value::makeInteger(node.getValue())));
+}
+
+void VMSpace::Compiler::visit(FloatNode& node) {
+    push(constant(Value::makeFloat(node.getValue())));
+}
+
+void VMSpace::Compiler::visit(StringNode& node) {
+    push(constant(Value::makeString(node.getValue())));
+}
+
+void VMSpace::Compiler::visit(ErrorNode& node) {
+    push(constant(Value::makeException(node.getMessage())));
+}
+
+} // namespace DemoLang
@@ -0,0 +1,268 @@
+/**
+ * @file src/vm/regcompiler.cpp
+ * @brief Compiler from pointer trees to three-address code, with linear scan register allocation.
+**/
+
+#include "regvm.hpp"
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+
+namespace DemoLang {
+
+namespace {
+
+using Op = VMSpace::RegisterProgram::Op;
+using Instruction = VMSpace::RegisterProgram::Instruction;
+
+// Instruction of a binary operator, BINARY for one without its own
+Op binaryOp(Operator op) {
+    switch (op) {
+        case Operator::PLUS:            return Op::ADD;
+        case Operator::MINUS:           return Op::SUB;
+        case Operator::MULTIPLY:        return Op::MUL;
+        case Operator::DIVIDE:          return Op::DIV;
+        case Operator::EQUAL:           return Op::EQ;
+        case Operator::NOT_EQUAL:       return Op::NE;
+        case Operator::LESS:            return Op::LT;
+        case Operator::LESS_EQUAL:      return Op::LE;
+        case Operator::GREATER:         return Op::GT;
+        case Operator::GREATER_EQUAL:   return Op::GE;
+        case Operator::AND:             return Op::AND;
+        case Operator::OR:              return Op::OR;
+        default:                        return Op::BINARY;
+    }
+}
+
+// Whether an instruction writes dst
+bool defines(Op op) {
+    return op != Op::SET && op != Op::FAIL && op != Op::RETURN;
+}
+
+// Whether a node's value is known never to be a string, only + builds strings.
+// Operands like these keep a chain linear when it is combined pair by pair
+bool numeric(ASTNode* node) {
+    if (dynamic_cast<IntNode*>(node) || dynamic_cast<FloatNode*>(node) || dynamic_cast<UnaryOpNode*>(node)) return true;
+    if (auto* binary = dynamic_cast<BinaryOpNode*>(node)) {
+        Operator op = operatorOf(binary->getOp());
+        return op != Operator::PLUS && op != Operator::ASSIGN;
+    }
+    if (auto* nary = dynamic_cast<NaryOpNode*>(node)) return operatorOf(nary->getOp()) != Operator::PLUS;
+    return false;
+}
+
+} // namespace
+
+
+VMSpace::RegisterProgram VMSpace::RegisterCompiler::compile(ASTNode& root) {
+    program = RegisterProgram();
+    pool.clear();
+    values.clear();
+    virtuals = 0;
+    chainTop = 0;
+    if (walk(root, maxDepth)) {
+        emit(Op::RETURN, Operator::NONE, pop(), 0);
+    } else {
+        emit(Op::FAIL, Operator::NONE, constant(Value::makeException("Maximum evaluation depth exceeded")), 0);
+    }
+    allocate();
+    return std::move(program);
+}
+
+
+void VMSpace::RegisterCompiler::allocate() {
+    std::vector<Instruction>& code = program.code;
+    // Live interval of every virtual register, from its definition to its last read
+    std::vector<uint32_t> start(virtuals), end(virtuals);
+    auto read = [&](uint32_t operand, uint32_t at) {
+        if (!(operand & (constantFlag | chainFlag))) end[operand] = at;
+    };
+    for (uint32_t i = 0; i < code.size(); i++) {
+        const Instruction& instruction = code[i];
+        if (defines(instruction.op) && !(instruction.dst & chainFlag)) start[instruction.dst] = end[instruction.dst] = i;
+        switch (instruction.op) {
+            case Op::GET:
+            case Op::CHAIN:     break;
+            case Op::SET:       read(instruction.b, i); break;
+            case Op::MOVE:
+            case Op::NEG:
+            case Op::NOT:
+            case Op::UNARY:
+            case Op::FAIL:
+            case Op::RETURN:    read(instruction.a, i); break;
+            default:
+                read(instruction.a, i);
+                read(instruction.b, i);
+                break;
+        }
+    }
+
+    // Virtual registers are numbered in order of definition, so intervals already come sorted by start.
+    // An interval ending where another starts frees its register for it, instructions read before they write
+    using Active = std::pair<uint32_t, uint32_t>;
+    std::priority_queue<Active, std::vector<Active>, std::greater<Active>> active;
+    std::vector<uint32_t> free;
+    std::vector<uint32_t> assigned(virtuals);
+    for (uint32_t v = 0; v < virtuals; v++) {
+        while (!active.empty() && active.top().first <= start[v]) {
+            free.push_back(active.top().second);
+            active.pop();
+        }
+        if (free.empty()) {
+            assigned[v] = program.registerCount++;
+        } else {
+            assigned[v] = free.back();
+            free.pop_back();
+        }
+        active.push({end[v], assigned[v]});
+    }
+
+    // Registers follow the constants in the frame, and chain slots follow the registers
+    uint32_t base = static_cast<uint32_t>(program.constants.size());
+    auto slot = [&](uint32_t operand) {
+        if (operand & constantFlag) return operand & ~constantFlag;
+        if (operand & chainFlag) return base + program.registerCount + (operand & ~chainFlag);
+        return base + assigned[operand];
+    };
+    for (Instruction& instruction : code) {
+        if (defines(instruction.op)) instruction.dst = slot(instruction.dst);
+        switch (instruction.op) {
+            case Op::GET:       break;
+            case Op::SET:       instruction.b = slot(instruction.b); break;
+            case Op::MOVE:
+            case Op::CHAIN:
+            case Op::NEG:
+            case Op::NOT:
+            case Op::UNARY:
+            case Op::FAIL:
+            case Op::RETURN:    instruction.a = slot(instruction.a); break;
+            default:
+                instruction.a = slot(instruction.a);
+                instruction.b = slot(instruction.b);
+                break;
+        }
+    }
+}
+
+
+uint32_t VMSpace::RegisterCompiler::constant(const Value& value) {
+    auto [it, added] = pool.try_emplace(constantKey(value), 0);
+    if (added) {
+        it->second = static_cast<uint32_t>(program.constants.size());
+        program.constants.push_back(value);
+    }
+    return it->second | constantFlag;
+}
+
+
+uint32_t VMSpace::RegisterCompiler::pop() {
+    uint32_t operand = values.back();
+    values.pop_back();
+    return operand;
+}
+
+
+void VMSpace::RegisterCompiler::emit(RegisterProgram::Op op, Operator aux, uint32_t a, uint32_t b) {
+    uint32_t dst = defines(op) ? virtuals++ : 0;
+    program.code.push_back({op, aux, dst, a, b});
+    if (defines(op)) values.push_back(dst);
+}
+
+
+void VMSpace::RegisterCompiler::visit(UnaryOpNode& node) {
+    if (schedule(node)) return;
+    Operator op = operatorOf(node.getOp());
+    Op instruction = op == Operator::MINUS ? Op::NEG : op == Operator::NOT ? Op::NOT : Op::UNARY;
+    emit(instruction, op, pop(), 0);
+}
+
+
+void VMSpace::RegisterCompiler::visit(BinaryOpNode& node) {
+    if (schedule(node)) return;
+    Operator op = operatorOf(node.getOp());
+    uint32_t right = pop();
+    if (auto* target = assignTarget(node)) {
+        // The assigned value is also the value of the assignment
+        program.code.push_back({Op::SET, op, 0, target->getSymbol(), right});
+        values.push_back(right);
+        return;
+    }
+    uint32_t left = pop();
+    if (op == Operator::ASSIGN) {
+        values.push_back(constant(Value::makeException("Left side of assignment must be an identifier")));
+        return;
+    }
+    emit(binaryOp(op), op, left, right);
+}
+
+
+void VMSpace::RegisterCompiler::visit(NaryOpNode& node) {
+    Operator op = operatorOf(node.getOp());
+    if (!task.combine) {
+        // Operand kinds are checked once here, the combine steps carry the outcome in their slot
+        const auto& operands = node.getOperands();
+        if (std::all_of(operands.begin(), operands.end(), [](const auto& operand) { return numeric(operand.get()); })) {
+            // Numbers give the same value pair by pair as executeChain. Combining has no effect,
+            // so each pair is combined as soon as its right operand is known and a long chain
+            // keeps two registers live
+            if (node.size() == 0) tasks.push_back({&node, task.depth, true});
+            for (size_t i = node.size(); i-- > 1;) {
+                tasks.push_back({&node, task.depth, true, pairSlot});
+                tasks.push_back({node.getOperand(i), task.depth + 1, false});
+            }
+            if (node.size() > 0) tasks.push_back({node.getOperand(0), task.depth + 1, false});
+            return;
+        }
+        // Anything else may join strings, so every operand is moved to a chain slot as it is
+        // known and one CHAIN combines them all, with the cost executeChain has
+        uint32_t first = chainTop;
+        chainTop += static_cast<uint32_t>(node.size());
+        program.chainCount = std::max(program.chainCount, chainTop);
+        tasks.push_back({&node, task.depth, true});
+        for (size_t i = node.size(); i-- > 0;) {
+            tasks.push_back({&node, task.depth, true, first + static_cast<uint32_t>(i)});
+            tasks.push_back({node.getOperand(i), task.depth + 1, false});
+        }
+        return;
+    }
+    if (task.slot == pairSlot) {
+        uint32_t right = pop();
+        uint32_t left = pop();
+        emit(binaryOp(op), op, left, right);
+        return;
+    }
+    if (task.slot != noSlot) {
+        program.code.push_back({Op::MOVE, Operator::NONE, task.slot | chainFlag, pop(), 0});
+        return;
+    }
+    if (node.size() == 0) {
+        values.push_back(constant(BinOperatorFactory::executeChain(op, {})));
+        return;
+    }
+    chainTop -= static_cast<uint32_t>(node.size());
+    emit(Op::CHAIN, op, chainTop | chainFlag, static_cast<uint32_t>(node.size()));
+}
+
+
+void VMSpace::RegisterCompiler::visit(IdNode& node) {
+    emit(Op::GET, Operator::NONE, node.getSymbol(), 0);
+}
+
+void VMSpace::RegisterCompiler::visit(IntNode& node) {
+    values.push_back(constant(Value::makeInteger(node.getValue())));
+}
+
+void VMSpace::RegisterCompiler::visit(FloatNode& node) {
+    values.push_back(constant(Value::makeFloat(node.getValue())));
+}
+
+void VMSpace::RegisterCompiler::visit(StringNode& node) {
+    values.push_back(constant(Value::makeString(node.getValue())));
+}
+
+void VMSpace::RegisterCompiler::visit(ErrorNode& node) {
+    values.push_back(constant(Value::makeException(node.getMessage())));
+}
+
+} // namespace DemoLang
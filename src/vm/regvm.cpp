@@ -0,0 +1,205 @@
+/**
+ * @file src/vm/regvm.cpp
+ * @brief Register machine and three-address code disassembler.
+**/
+
+#include "regvm.hpp"
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+
+
+namespace DemoLang {
+
+const char* VMSpace::RegisterProgram::name(Op op) {
+    switch (op) {
+        case Op::GET:       return "GET";
+        case Op::SET:       return "SET";
+        case Op::MOVE:      return "MOVE";
+        case Op::NEG:       return "NEG";
+        case Op::NOT:       return "NOT";
+        case Op::UNARY:     return "UNARY";
+        case Op::ADD:       return "ADD";
+        case Op::SUB:       return "SUB";
+        case Op::MUL:       return "MUL";
+        case Op::DIV:       return "DIV";
+        case Op::EQ:        return "EQ";
+        case Op::NE:        return "NE";
+        case Op::LT:        return "LT";
+        case Op::LE:        return "LE";
+        case Op::GT:        return "GT";
+        case Op::GE:        return "GE";
+        case Op::AND:       return "AND";
+        case Op::OR:        return "OR";
+        case Op::BINARY:    return "BINARY";
+        case Op::CHAIN:     return "CHAIN";
+        case Op::FAIL:      return "FAIL";
+        case Op::RETURN:    return "RETURN";
+        default:            return "UNKNOWN";
+    }
+}
+
+
+std::string VMSpace::RegisterProgram::disassemble() const {
+    std::ostringstream out;
+    // Constant slots print as k, register slots as r and chain slots as c
+    auto slot = [this](uint32_t index) {
+        if (index < constants.size()) return "k" + std::to_string(index);
+        index -= static_cast<uint32_t>(constants.size());
+        return index < registerCount ? "r" + std::to_string(index) : "c" + std::to_string(index - registerCount);
+    };
+
+    for (size_t i = 0; i < constants.size(); i++) out << 'k' << i << " = " << Interpreter::render(constants[i]) << '\n';
+    for (size_t i = 0; i < code.size(); i++) {
+        const Instruction& instruction = code[i];
+        out << std::setw(4) << std::setfill('0') << i << ' ' << name(instruction.op) << ' ';
+        switch (instruction.op) {
+            case Op::GET:
+                out << slot(instruction.dst) << ", " << SymbolTable::instance().name(instruction.a);
+                break;
+            case Op::SET:
+                out << SymbolTable::instance().name(instruction.a) << ", " << slot(instruction.b);
+                break;
+            case Op::MOVE:
+            case Op::NEG:
+            case Op::NOT:
+                out << slot(instruction.dst) << ", " << slot(instruction.a);
+                break;
+            case Op::UNARY:
+                out << static_cast<int>(instruction.aux) << ' ' << slot(instruction.dst) << ", " << slot(instruction.a);
+                break;
+            case Op::CHAIN:
+                out << static_cast<int>(instruction.aux) << ' ' << slot(instruction.dst) << ", "
+                    << slot(instruction.a) << ", " << instruction.b;
+                break;
+            case Op::FAIL:
+            case Op::RETURN:
+                out << slot(instruction.a);
+                break;
+            case Op::BINARY:
+                out << static_cast<int>(instruction.aux) << ' ';
+                [[fallthrough]];
+            default:
+                out << slot(instruction.dst) << ", " << slot(instruction.a) << ", " << slot(instruction.b);
+                break;
+        }
+        out << '\n';
+    }
+    return out.str();
+}
+
+
+std::string VMSpace::RegisterVM::interpret(const RegisterProgram& program) {
+    return Interpreter::render(run(program));
+}
+
+
+std::string VMSpace::RegisterVM::interpret(const std::shared_ptr<ASTNode>& node) {
+    if (!node) return Interpreter::render(Value::makeException("Null AST Node"));
+    return interpret(RegisterCompiler().compile(*node));
+}
+
+
+Value VMSpace::RegisterVM::run(const RegisterProgram& program) {
+    if (program.empty()) return Value();
+
+    // Constants are copied into their slots once per run, so literals cost no instruction
+    frame.assign(program.getConstants().begin(), program.getConstants().end());
+    frame.resize(program.getFrameSize());
+    Value* slots = frame.data();
+    const RegisterProgram::Instruction* ip = program.getCode().data();
+    Value result;
+
+#ifdef DEMOLANG_THREADED_DISPATCH
+    // One indirect jump per instruction, in the order of Op
+    static const void* const labels[] = {
+        &&op_GET, &&op_SET, &&op_MOVE, &&op_NEG, &&op_NOT, &&op_UNARY,
+        &&op_ADD, &&op_SUB, &&op_MUL, &&op_DIV, &&op_EQ, &&op_NE, &&op_LT, &&op_LE, &&op_GT, &&op_GE,
+        &&op_AND, &&op_OR, &&op_BINARY, &&op_CHAIN, &&op_FAIL, &&op_RETURN
+    };
+    static_assert(std::size(labels) == RegisterProgram::opCount, "Every instruction needs a label");
+#define DEMOLANG_CASE(name) op_##name:
+#define DEMOLANG_NEXT goto *labels[static_cast<size_t>((++ip)->op)]
+    goto *labels[static_cast<size_t>(ip->op)];
+#else
+    using Op = RegisterProgram::Op;
+#define DEMOLANG_CASE(name) case Op::name:
+#define DEMOLANG_NEXT continue
+    for (;; ++ip) switch (ip->op) {
+#endif
+
+#define DEMOLANG_BINARY(name, op) \
+    DEMOLANG_CASE(name) { \
+        slots[ip->dst] = BinOperatorFactory::execute(Operator::op, slots[ip->a], slots[ip->b]); \
+        DEMOLANG_NEXT; \
+    }
+
+    DEMOLANG_CASE(GET) {
+        slots[ip->dst] = env.has(ip->a) ? env.get(ip->a)
+            : Value::makeException("Undefined variable: " + SymbolTable::instance().name(ip->a));
+        DEMOLANG_NEXT;
+    }
+    DEMOLANG_CASE(SET) {
+        env.set(ip->a, slots[ip->b]);
+        DEMOLANG_NEXT;
+    }
+    DEMOLANG_CASE(MOVE) {
+        slots[ip->dst] = slots[ip->a];
+        DEMOLANG_NEXT;
+    }
+    DEMOLANG_CASE(NEG) {
+        slots[ip->dst] = UnaryOperatorFactory::execute(Operator::MINUS, slots[ip->a]);
+        DEMOLANG_NEXT;
+    }
+    DEMOLANG_CASE(NOT) {
+        slots[ip->dst] = UnaryOperatorFactory::execute(Operator::NOT, slots[ip->a]);
+        DEMOLANG_NEXT;
+    }
+    DEMOLANG_CASE(UNARY) {
+        slots[ip->dst] = UnaryOperatorFactory::execute(ip->aux, slots[ip->a]);
+        DEMOLANG_NEXT;
+    }
+    DEMOLANG_BINARY(ADD, PLUS)
+    DEMOLANG_BINARY(SUB, MINUS)
+    DEMOLANG_BINARY(MUL, MULTIPLY)
+    DEMOLANG_BINARY(DIV, DIVIDE)
+    DEMOLANG_BINARY(EQ, EQUAL)
+    DEMOLANG_BINARY(NE, NOT_EQUAL)
+    DEMOLANG_BINARY(LT, LESS)
+    DEMOLANG_BINARY(LE, LESS_EQUAL)
+    DEMOLANG_BINARY(GT, GREATER)
+    DEMOLANG_BINARY(GE, GREATER_EQUAL)
+    DEMOLANG_BINARY(AND, AND)
+    DEMOLANG_BINARY(OR, OR)
+    DEMOLANG_CASE(BINARY) {
+        slots[ip->dst] = BinOperatorFactory::execute(ip->aux, slots[ip->a], slots[ip->b]);
+        DEMOLANG_NEXT;
+    }
+    DEMOLANG_CASE(CHAIN) {
+        // The operands sit side by side in chain slots, nothing is copied
+        slots[ip->dst] = BinOperatorFactory::executeChain(ip->aux, slots + ip->a, ip->b);
+        DEMOLANG_NEXT;
+    }
+    DEMOLANG_CASE(FAIL) {
+        result = slots[ip->a];
+        goto done;
+    }
+    DEMOLANG_CASE(RETURN) {
+        result = std::move(slots[ip->a]);
+        goto done;
+    }
+
+#ifndef DEMOLANG_THREADED_DISPATCH
+    }
+#endif
+#undef DEMOLANG_BINARY
+#undef DEMOLANG_NEXT
+#undef DEMOLANG_CASE
+
+done:
+    // Strings held by registers are released now rather than on the next run
+    frame.clear();
+    return result;
+}
+
+} // namespace DemoLang
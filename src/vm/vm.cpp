@@ -0,0 +1,159 @@
+/**
+ * @file src/vm/vm.cpp
+ * @brief Stack machine with threaded dispatch.
+**/
+
+#include "vm.hpp"
+#include <iterator>
+
+
+namespace DemoLang {
+
+namespace {
+
+// Operand stored little-endian after an opcode
+uint32_t word(const uint8_t* code) {
+    return static_cast<uint32_t>(code[0]) | static_cast<uint32_t>(code[1]) << 8
+         | static_cast<uint32_t>(code[2]) << 16 | static_cast<uint32_t>(code[3]) << 24;
+}
+
+} // namespace
+
+
+bool VMSpace::VM::threaded() {
+#ifdef DEMOLANG_THREADED_DISPATCH
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+std::string VMSpace::VM::interpret(const Chunk& chunk) {
+    return Interpreter::render(run(chunk));
+}
+
+
+std::string VMSpace::VM::interpret(const std::shared_ptr<ASTNode>& node) {
+    if (!node) return Interpreter::render(Value::makeException("Null AST Node"));
+    return interpret(Compiler().compile(*node));
+}
+
+
+Value VMSpace::VM::run(const Chunk& chunk) {
+    if (chunk.empty()) return Value();
+
+    // The compiler knows how deep the stack gets, so pushes are not bounds checked
+    stack.resize(chunk.getStackSize());
+    Value* sp = stack.data();
+    const uint8_t* ip = chunk.getCode().data();
+    const Value* constants = chunk.getConstants().data();
+    Value result;
+
+#ifdef DEMOLANG_THREADED_DISPATCH
+    // One indirect jump per instruction, in the order of Opcode
+    static const void* const labels[] = {
+        &&op_CONSTANT, &&op_LOAD, &&op_STORE, &&op_POP, &&op_NEG, &&op_NOT, &&op_UNARY,
+        &&op_ADD, &&op_SUB, &&op_MUL, &&op_DIV, &&op_EQ, &&op_NE, &&op_LT, &&op_LE, &&op_GT, &&op_GE,
+        &&op_AND, &&op_OR, &&op_BINARY, &&op_CHAIN, &&op_FAIL, &&op_RETURN
+    };
+    static_assert(std::size(labels) == opcodeCount, "Every opcode needs a label");
+#define DEMOLANG_CASE(name) op_##name:
+#define DEMOLANG_NEXT goto *labels[*ip++]
+    DEMOLANG_NEXT;
+#else
+#define DEMOLANG_CASE(name) case Opcode::name:
+#define DEMOLANG_NEXT continue
+    for (;;) switch (static_cast<Opcode>(*ip++)) {
+#endif
+
+#define DEMOLANG_BINARY(name, op) \
+    DEMOLANG_CASE(name) { \
+        sp[-2] = BinOperatorFactory::execute(Operator::op, sp[-2], sp[-1]); \
+        --sp; \
+        DEMOLANG_NEXT; \
+    }
+
+    DEMOLANG_CASE(CONSTANT) {
+        *sp++ = constants[word(ip)];
+        ip += 4;
+        DEMOLANG_NEXT;
+    }
+    DEMOLANG_CASE(LOAD) {
+        uint32_t symbol = word(ip);
+        ip += 4;
+        *sp++ = env.has(symbol) ? env.get(symbol)
+            : Value::makeException("Undefined variable: " + SymbolTable::instance().name(symbol));
+        DEMOLANG_NEXT;
+    }
+    DEMOLANG_CASE(STORE) {
+        env.set(word(ip), sp[-1]);
+        ip += 4;
+        DEMOLANG_NEXT;
+    }
+    DEMOLANG_CASE(POP) {
+        --sp;
+        DEMOLANG_NEXT;
+    }
+    DEMOLANG_CASE(NEG) {
+        sp[-1] = UnaryOperatorFactory::execute(Operator::MINUS, sp[-1]);
+        DEMOLANG_NEXT;
+    }
+    DEMOLANG_CASE(NOT) {
+        sp[-1] = UnaryOperatorFactory::execute(Operator::NOT, sp[-1]);
+        DEMOLANG_NEXT;
+    }
+    DEMOLANG_CASE(UNARY) {
+        sp[-1] = UnaryOperatorFactory::execute(static_cast<Operator>(*ip++), sp[-1]);
+        DEMOLANG_NEXT;
+    }
+    DEMOLANG_BINARY(ADD, PLUS)
+    DEMOLANG_BINARY(SUB, MINUS)
+    DEMOLANG_BINARY(MUL, MULTIPLY)
+    DEMOLANG_BINARY(DIV, DIVIDE)
+    DEMOLANG_BINARY(EQ, EQUAL)
+    DEMOLANG_BINARY(NE, NOT_EQUAL)
+    DEMOLANG_BINARY(LT, LESS)
+    DEMOLANG_BINARY(LE, LESS_EQUAL)
+    DEMOLANG_BINARY(GT, GREATER)
+    DEMOLANG_BINARY(GE, GREATER_EQUAL)
+    DEMOLANG_BINARY(AND, AND)
+    DEMOLANG_BINARY(OR, OR)
+    DEMOLANG_CASE(BINARY) {
+        sp[-2] = BinOperatorFactory::execute(static_cast<Operator>(*ip++), sp[-2], sp[-1]);
+        --sp;
+        DEMOLANG_NEXT;
+    }
+    DEMOLANG_CASE(CHAIN) {
+        Operator op = static_cast<Operator>(*ip++);
+        uint32_t count = word(ip);
+        ip += 4;
+        chain.assign(std::make_move_iterator(sp - count), std::make_move_iterator(sp));
+        sp -= count;
+        *sp++ = BinOperatorFactory::executeChain(op, chain);
+        DEMOLANG_NEXT;
+    }
+    DEMOLANG_CASE(FAIL) {
+        result = constants[word(ip)];
+        goto done;
+    }
+    DEMOLANG_CASE(RETURN) {
+        result = std::move(sp[-1]);
+        goto done;
+    }
+
+#ifndef DEMOLANG_THREADED_DISPATCH
+    }
+#endif
+#undef DEMOLANG_BINARY
+#undef DEMOLANG_NEXT
+#undef DEMOLANG_CASE
+
+done:
+    // Strings left in dropped slots are released now rather than on the next run
+    stack.clear();
+    chain.clear();
+    return result;
+}
+
+} // namespace DemoLang
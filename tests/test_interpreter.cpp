@@ -9,6 +9,11 @@
 #include "ast.hpp"
 #include "builtins.hpp"
 #include "interpreter.hpp"
+#include "flat.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <random>
 
 using namespace DemoLang;
 using namespace DemoLang::AST;
@@ -16,6 +21,27 @@ using namespace DemoLang::ValueTypes;
 using namespace DemoLang::InterpreterSpace;
 
 
+// Counts heap allocations, so tests can check a path makes none
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    if (void* memory = std::malloc(size ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+// Memory from the operator new above is released with free, which GCC cannot tell
+// from releasing new'd memory. The array forms call these, aligned ones are left as they are
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+
 class InterpreterTestCase : public TestCase {
 protected:
     Interpreter* interpreter;
@@ -112,6 +138,360 @@ public:
 };
 
 
+class TestSymbolSlots : public InterpreterTestCase {
+public:
+    void run() override {
+        // Nodes built from a name and from its symbol id address the same slot
+        uint32_t symbol = SymbolTable::instance().intern("slot_var");
+        auto assign = std::make_shared<BinaryOpNode>("=", std::make_shared<IdNode>("slot_var"), std::make_shared<IntNode>(42));
+        assert(interpreter->interpret(assign) == "42");
+        assert(interpreter->interpret(std::make_shared<IdNode>(symbol)) == "42");
+
+        // Many variables stay independent
+        for (int i = 0; i < 2000; i++) {
+            auto id = std::make_shared<IdNode>("many_" + std::to_string(i));
+            interpreter->interpret(std::make_shared<BinaryOpNode>("=", id, std::make_shared<IntNode>(i)));
+        }
+        for (int i = 0; i < 2000; i += 97) {
+            assert(interpreter->interpret(std::make_shared<IdNode>("many_" + std::to_string(i))) == std::to_string(i));
+        }
+    }
+};
+
+
+class TestFlatEvaluator : public InterpreterTestCase {
+private:
+    std::mt19937 random{42};
+
+    // Random tree over every node kind, including operators nothing parses to
+    std::shared_ptr<ASTNode> randomTree(int depth) {
+        static const std::vector<std::string> binary = {"+", "-", "*", "/", "==", "!=", "<", "<=", ">", ">=", "&", "|", "%"};
+        static const std::vector<std::string> names = {"flat_a", "flat_b", "flat_unset"};
+        switch (depth <= 0 ? random() % 5 : random() % 9) {
+            case 0: return std::make_shared<IntNode>(static_cast<long long>(random() % 7) - 2);
+            case 1: return std::make_shared<FloatNode>((random() % 9) * 0.5L);
+            case 2: return std::make_shared<StringNode>(random() % 2 ? "x" : "");
+            case 3: return std::make_shared<IdNode>(names[random() % names.size()]);
+            case 4: return std::make_shared<ErrorNode>("Broken");
+            case 5: return std::make_shared<UnaryOpNode>(random() % 3 ? (random() % 2 ? "-" : "!") : "~", randomTree(depth - 1));
+            case 6: return std::make_shared<BinaryOpNode>("=", randomTree(depth - 1), std::make_shared<IntNode>(1));
+            default: return std::make_shared<BinaryOpNode>(binary[random() % binary.size()], randomTree(depth - 1), randomTree(depth - 1));
+        }
+    }
+
+public:
+    void run() override {
+        interpreter->interpret(std::make_shared<BinaryOpNode>("=", std::make_shared<IdNode>("flat_a"), std::make_shared<IntNode>(3)));
+        interpreter->interpret(std::make_shared<BinaryOpNode>("=", std::make_shared<IdNode>("flat_b"), std::make_shared<FloatNode>(1.5)));
+
+        for (int i = 0; i < 5000; i++) {
+            auto tree = randomTree(5);
+            std::string expected = interpreter->interpret(tree);
+            assert(interpreter->interpret(FlatAST(*tree)) == expected);
+            // The pointer view rebuilt from the flat tree evaluates the same way
+            assert(interpreter->interpret(FlatAST(*tree).toTree()) == expected);
+        }
+
+        // Assignments write the environment and yield the value
+        interpreter->interpret(FlatAST(*std::make_shared<BinaryOpNode>("=", std::make_shared<IdNode>("flat_a"), std::make_shared<IntNode>(3))));
+        auto assign = std::make_shared<BinaryOpNode>("=", std::make_shared<IdNode>("flat_c"),
+            std::make_shared<BinaryOpNode>("*", std::make_shared<IdNode>("flat_a"), std::make_shared<IntNode>(4)));
+        assert(interpreter->interpret(FlatAST(*assign)) == "12");
+        assert(interpreter->interpret(std::make_shared<IdNode>("flat_c")) == "12");
+        assert(interpreter->interpret(FlatAST()) == "Null AST Node");
+    }
+};
+
+
+class TestSharedStatements : public InterpreterTestCase {
+private:
+    static std::shared_ptr<ASTNode> id(const std::string& name) { return std::make_shared<IdNode>(name); }
+    static std::shared_ptr<ASTNode> num(long long value) { return std::make_shared<IntNode>(value); }
+    static std::shared_ptr<ASTNode> bin(const std::string& op, std::shared_ptr<ASTNode> l, std::shared_ptr<ASTNode> r) {
+        return std::make_shared<BinaryOpNode>(op, l, r);
+    }
+
+public:
+    void run() override {
+        // s_x + (s_x = s_x * 2) + s_x reads the variable before and after the assignment
+        auto twice = bin("+", bin("+", id("s_x"), bin("=", id("s_x"), bin("*", id("s_x"), num(2)))), id("s_x"));
+        interpreter->interpret(bin("=", id("s_x"), num(3)));
+        assert(interpreter->interpret(twice) == "15");
+        interpreter->interpret(bin("=", id("s_x"), num(3)));
+        assert(interpreter->interpret(FlatAST(*twice)) == "15");
+
+        // Statements of one tree reuse shared values until an input changes
+        auto sum = [&]() { return bin("+", bin("*", id("s_p"), id("s_q")), num(1)); };
+        std::vector<std::shared_ptr<ASTNode>> statements = {
+            bin("=", id("s_p"), num(4)), bin("=", id("s_q"), num(5)),
+            bin("=", id("s_t"), sum()), bin("=", id("s_u"), sum()),
+            bin("=", id("s_p"), num(10)), bin("=", id("s_v"), sum()), sum()
+        };
+        std::vector<std::string> expected = {"4", "5", "21", "21", "10", "51", "51"};
+        FlatAST program;
+        for (size_t i = 0; i < statements.size(); i++) {
+            program.append(*statements[i]);
+            assert(interpreter->interpret(program, i) == expected[i]);
+        }
+        // The whole program evaluates the same way in one go
+        assert(interpreter->interpret(program) == "51");
+        assert(interpreter->interpret(id("s_p")) == "10");
+    }
+};
+
+
+class TestDeepTrees : public InterpreterTestCase {
+public:
+    void run() override {
+        // Nodes live in an arena, so releasing the tree does not recurse either
+        ASTArena arena;
+        auto sum = arena.make<IntNode>(0);
+        for (int i = 0; i < 100000; i++) sum = arena.make<BinaryOpNode>("+", sum, arena.make<IntNode>(1));
+        auto negated = arena.make<IntNode>(7);
+        for (int i = 0; i < 100001; i++) negated = arena.make<UnaryOpNode>("-", negated);
+
+        assert(interpreter->interpret(sum) == "100000");
+        assert(interpreter->interpret(negated) == "-7");
+        assert(interpreter->interpret(FlatAST(*sum)) == "100000");
+        assert(interpreter->interpret(FlatAST(*negated)) == "-7");
+
+        // Deeper trees than allowed evaluate to an exception
+        interpreter->setMaxDepth(1000);
+        assert(interpreter->interpret(negated) == "Maximum evaluation depth exceeded");
+        assert(interpreter->interpret(arena.make<IntNode>(1)) == "1");
+        interpreter->setMaxDepth(Interpreter::defaultMaxDepth);
+    }
+};
+
+
+class TestTypedEvaluation : public InterpreterTestCase {
+private:
+    std::mt19937 random{19};
+
+    // Mostly numeric trees, so typed regions meet untyped ones often
+    std::shared_ptr<ASTNode> randomTree(int depth) {
+        static const std::vector<std::string> binary = {"+", "-", "*", "/", "==", "!=", "<", "<=", ">", ">=", "&", "|"};
+        static const std::vector<std::string> names = {"typed_a", "typed_b", "typed_c"};
+        switch (depth <= 0 ? random() % 6 : random() % 11) {
+            case 0:
+            case 1: return std::make_shared<IntNode>(static_cast<long long>(random() % 7) - 3);
+            case 2: return std::make_shared<FloatNode>(random() % 4 ? (random() % 7) * 0.5L - 1.5L : -0.0L);
+            case 3: return std::make_shared<StringNode>(random() % 2 ? "x" : "");
+            case 4:
+            case 5: return std::make_shared<IdNode>(names[random() % names.size()]);
+            case 6: return std::make_shared<UnaryOpNode>(random() % 2 ? "-" : "!", randomTree(depth - 1));
+            case 7: {
+                std::vector<std::shared_ptr<ASTNode>> operands;
+                for (int k = 2 + random() % 3; k > 0; k--) operands.push_back(randomTree(depth - 1));
+                return std::make_shared<NaryOpNode>(random() % 2 ? "+" : "*", std::move(operands));
+            }
+            default: return std::make_shared<BinaryOpNode>(binary[random() % binary.size()], randomTree(depth - 1), randomTree(depth - 1));
+        }
+    }
+
+    std::shared_ptr<ASTNode> randomStatement() {
+        static const std::vector<std::string> names = {"typed_a", "typed_b", "typed_c"};
+        if (random() % 2) return randomTree(3);
+        return std::make_shared<BinaryOpNode>("=", std::make_shared<IdNode>(names[random() % names.size()]), randomTree(3));
+    }
+
+    void reset() {
+        for (const char* name : {"typed_a", "typed_b", "typed_c"}) {
+            interpreter->interpret(std::make_shared<BinaryOpNode>("=", std::make_shared<IdNode>(name), std::make_shared<IntNode>(2)));
+        }
+    }
+
+public:
+    void run() override {
+        // Statements of one tree see the types assigned by earlier ones, and
+        // every result matches the boxed pointer evaluator
+        for (int i = 0; i < 1000; i++) {
+            std::vector<std::shared_ptr<ASTNode>> statements;
+            for (int k = 0; k < 6; k++) statements.push_back(randomStatement());
+
+            reset();
+            std::vector<std::string> expected;
+            for (const auto& statement : statements) expected.push_back(interpreter->interpret(statement));
+
+            reset();
+            FlatAST program;
+            for (size_t k = 0; k < statements.size(); k++) {
+                program.append(*statements[k]);
+                assert(interpreter->interpret(program, k) == expected[k]);
+            }
+        }
+
+        // A numeric loop body stays typed from end to end
+        FlatAST program;
+        program.append(*std::make_shared<BinaryOpNode>("=", std::make_shared<IdNode>("typed_a"), std::make_shared<IntNode>(1)));
+        auto step = std::make_shared<BinaryOpNode>("=", std::make_shared<IdNode>("typed_a"),
+            std::make_shared<BinaryOpNode>("+", std::make_shared<BinaryOpNode>("*", std::make_shared<IdNode>("typed_a"),
+                std::make_shared<IntNode>(3)), std::make_shared<IntNode>(1)));
+        for (int k = 0; k < 5; k++) program.append(*step);
+        for (uint32_t k = program.statementBegin(1); k < program.size(); k++) {
+            assert(program.type(k) == StaticType::INTEGER);
+        }
+        assert(interpreter->interpret(program) == "364");
+    }
+};
+
+
+class TestOperatorChains : public InterpreterTestCase {
+private:
+    std::mt19937 random{7};
+
+    Value randomValue() {
+        switch (random() % 6) {
+            case 0: return Value::makeFloat((random() % 7) * 0.25L - 0.5L);
+            case 1: return Value::makeString(random() % 2 ? "ab" : "");
+            case 2: if (random() % 4 == 0) return Value::makeException("Broken");
+                    [[fallthrough]];
+            default: return Value::makeInteger(static_cast<long long>(random() % 9) - 4);
+        }
+    }
+
+public:
+    void run() override {
+        // A chain gives exactly what applying the operator pair by pair gives
+        for (Operator op : {Operator::PLUS, Operator::MULTIPLY, Operator::MINUS}) {
+            for (int i = 0; i < 3000; i++) {
+                std::vector<Value> operands;
+                size_t count = 1 + random() % 6;
+                for (size_t k = 0; k < count; k++) operands.push_back(randomValue());
+                auto expected = operands[0];
+                for (size_t k = 1; k < count; k++) expected = BinOperatorFactory::execute(op, expected, operands[k]);
+
+                auto actual = BinOperatorFactory::executeChain(op, operands);
+                assert(actual.getType() == expected.getType());
+                if (expected.isInteger()) assert(actual.getInteger() == expected.getInteger());
+                else if (expected.isFloat()) assert(actual.getFloat() == expected.getFloat());
+                else assert(actual.getString() == expected.getString());
+            }
+        }
+
+        // Integers stay exact up to the first Float, which promotes the rest
+        auto sum = std::make_shared<NaryOpNode>("+", std::vector<std::shared_ptr<ASTNode>>{
+            std::make_shared<IntNode>(1), std::make_shared<IntNode>(2), std::make_shared<FloatNode>(0.5), std::make_shared<IntNode>(3)
+        });
+        assert(interpreter->interpret(sum) == "6.500000");
+        assert(interpreter->interpret(FlatAST(*sum)) == "6.500000");
+        assert(interpreter->interpret(FlatAST(*sum).toTree()) == "6.500000");
+        auto joined = std::make_shared<NaryOpNode>("+", std::vector<std::shared_ptr<ASTNode>>{
+            std::make_shared<StringNode>("Hello"), std::make_shared<StringNode>(", "), std::make_shared<StringNode>("World")
+        });
+        assert(interpreter->interpret(joined) == "Hello, World");
+        assert(interpreter->interpret(FlatAST(*joined)) == "Hello, World");
+        auto broken = std::make_shared<NaryOpNode>("*", std::vector<std::shared_ptr<ASTNode>>{
+            std::make_shared<IntNode>(2), std::make_shared<StringNode>("x"), std::make_shared<IntNode>(3)
+        });
+        assert(interpreter->interpret(broken) == "Type error");
+        assert(interpreter->interpret(FlatAST(*broken)) == "Type error");
+    }
+};
+
+
+class TestOperatorTable : public InterpreterTestCase {
+private:
+    // The operator semantics written out with run-time type checks
+    static Value reference(Operator op, const Value& left, const Value& right) {
+        auto truth = [](const Value& value) {
+            return value.isNumeric() ? value.toFloat() != 0.0 : value.isString() && !value.getString().empty();
+        };
+        auto boolean = [](bool holds) { return Value::makeInteger(holds ? 1 : 0); };
+        bool strings = left.isString() && right.isString();
+        bool integers = left.isInteger() && right.isInteger();
+        long double l = left.isNumeric() ? left.toFloat() : 0, r = right.isNumeric() ? right.toFloat() : 0;
+
+        if (op == Operator::AND) return boolean(truth(left) && truth(right));
+        if (op == Operator::OR) return boolean(truth(left) || truth(right));
+        if (strings && op == Operator::PLUS) return Value::makeString(left.getString() + right.getString());
+        if (strings && op == Operator::EQUAL) return boolean(left.getString() == right.getString());
+        if (strings && op == Operator::NOT_EQUAL) return boolean(left.getString() != right.getString());
+        bool supported = true;
+        switch (op) {
+            case Operator::PLUS: case Operator::MINUS: case Operator::MULTIPLY: case Operator::DIVIDE:
+            case Operator::EQUAL: case Operator::NOT_EQUAL: case Operator::LESS: case Operator::LESS_EQUAL:
+            case Operator::GREATER: case Operator::GREATER_EQUAL: break;
+            default: supported = false;
+        }
+        if (!supported) return Value::makeException("Unsupported operator");
+        if (!left.isNumeric() || !right.isNumeric()) return Value::makeException("Type error");
+        switch (op) {
+            case Operator::PLUS: return integers ? Value::makeInteger(left.getInteger() + right.getInteger()) : Value::makeFloat(l + r);
+            case Operator::MINUS: return integers ? Value::makeInteger(left.getInteger() - right.getInteger()) : Value::makeFloat(l - r);
+            case Operator::MULTIPLY: return integers ? Value::makeInteger(left.getInteger() * right.getInteger()) : Value::makeFloat(l * r);
+            case Operator::DIVIDE: return r == 0.0 ? Value::makeException("Division by zero") : Value::makeFloat(l / r);
+            case Operator::EQUAL: return boolean(l == r);
+            case Operator::NOT_EQUAL: return boolean(l != r);
+            case Operator::LESS: return boolean(l < r);
+            case Operator::LESS_EQUAL: return boolean(l <= r);
+            case Operator::GREATER: return boolean(l > r);
+            default: return boolean(l >= r);
+        }
+    }
+
+    static bool same(const Value& a, const Value& b) {
+        if (a.getType() != b.getType()) return false;
+        if (a.isInteger()) return a.getInteger() == b.getInteger();
+        if (a.isFloat()) return std::to_string(a.getFloat()) == std::to_string(b.getFloat()) && std::signbit(a.getFloat()) == std::signbit(b.getFloat());
+        return a.isNone() || a.getString() == b.getString();
+    }
+
+public:
+    void run() override {
+        std::vector<Value> values = {
+            Value(), Value::makeInteger(0), Value::makeInteger(-3), Value::makeInteger(7),
+            Value::makeFloat(0.0L), Value::makeFloat(-0.0L), Value::makeFloat(2.5L),
+            Value::makeString(""), Value::makeString("ab"), Value::makeException("Broken")
+        };
+        // Every operator, including the ones no binary expression uses, for every pair of types
+        for (size_t op = 0; op <= operatorCount; op++) {
+            for (const Value& left : values) {
+                for (const Value& right : values) {
+                    Operator id = static_cast<Operator>(op);
+                    assert(same(BinOperatorFactory::execute(id, left, right), reference(id, left, right)));
+                }
+            }
+        }
+        assert(BinOperatorFactory::kernel(Operator::PLUS, Value::Type::INTEGER, Value::Type::FLOAT)
+            != BinOperatorFactory::kernel(Operator::PLUS, Value::Type::INTEGER, Value::Type::INTEGER));
+    }
+};
+
+
+class TestValues : public InterpreterTestCase {
+public:
+    void run() override {
+        // Copies share the text, moves leave an empty value behind
+        Value text = Value::makeString("shared");
+        Value copy = text;
+        assert(&copy.getString() == &text.getString());
+        Value moved = std::move(copy);
+        assert(copy.isNone() && moved.getString() == "shared");
+        copy = moved;
+        text = Value::makeInteger(5);
+        assert(copy.getString() == "shared" && text.getInteger() == 5);
+        assert(Value().isNone() && !Value().isNumeric());
+        assert(Value::makeException("Broken").isException());
+        assert(sizeof(Value) <= 2 * sizeof(long double));
+
+        // Integer arithmetic allocates nothing, from variables or literals
+        interpreter->interpret(std::make_shared<BinaryOpNode>("=", std::make_shared<IdNode>("value_n"), std::make_shared<IntNode>(6)));
+        auto sum = std::make_shared<BinaryOpNode>("-", std::make_shared<BinaryOpNode>("+", std::make_shared<IdNode>("value_n"),
+            std::make_shared<BinaryOpNode>("*", std::make_shared<IntNode>(3), std::make_shared<IdNode>("value_n"))), std::make_shared<IntNode>(4));
+        FlatAST flat(*sum);
+        interpreter->evaluate(*sum);
+        interpreter->evaluate(flat);
+        size_t before = allocations;
+        Value pointer = interpreter->evaluate(*sum);
+        Value flatValue = interpreter->evaluate(flat);
+        assert(allocations == before);
+        assert(pointer.getInteger() == 20 && flatValue.getInteger() == 20);
+        assert(Interpreter::instance().interpret(flat) == "20");
+    }
+};
+
+
 class TestErrorHandling : public InterpreterTestCase {
 public:
     void run() override {
@@ -133,6 +513,14 @@ int main() {
     runner.addTest("Interpreter: Binary Operators", std::make_shared<TestBinaryOperators>());
     runner.addTest("Interpreter: Literals", std::make_shared<TestLiterals>());
     runner.addTest("Interpreter: Variables", std::make_shared<TestVariables>());
+    runner.addTest("Interpreter: Symbol Slots", std::make_shared<TestSymbolSlots>());
+    runner.addTest("Interpreter: Flat Evaluator", std::make_shared<TestFlatEvaluator>());
+    runner.addTest("Interpreter: Shared Statements", std::make_shared<TestSharedStatements>());
+    runner.addTest("Interpreter: Deep Trees", std::make_shared<TestDeepTrees>());
+    runner.addTest("Interpreter: Typed Evaluation", std::make_shared<TestTypedEvaluation>());
+    runner.addTest("Interpreter: Operator Chains", std::make_shared<TestOperatorChains>());
+    runner.addTest("Interpreter: Operator Table", std::make_shared<TestOperatorTable>());
+    runner.addTest("Interpreter: Values", std::make_shared<TestValues>());
     runner.addTest("Interpreter: Error Handling", std::make_shared<TestErrorHandling>());
     runner.runAll();
 
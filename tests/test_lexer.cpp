@@ -8,6 +8,9 @@
 #include "test_framework.hpp"
 #include "tokens.hpp"
 #include "lexer.hpp"
+#include <sstream>
+#include <stdexcept>
+#include <thread>
 
 using namespace DemoLang;
 using namespace DemoLang::Tokens;
@@ -129,6 +132,250 @@ public:
 };
 
 
+class TestTableMatchesChain : public LexerTestCase {
+public:
+    void run() override {
+        const std::vector<std::string> inputs = {
+            "x = (1 + 2.5) * -y", "a>=b!=c<=d==e", "'a\\'b' \"c\"", "12abc", "a.b",
+            "a ", "a  b", "  a", "\"ab", "\"a\\", "1.", "1.2.3", "a\tb\n", "{}&|!",
+            "name = \"Hi, \" + name + \"!\"", "\x80", std::string("a\0b", 3)
+        };
+        for (const auto& input : inputs) {
+            lexer->setMode(LexerMode::CHAIN);
+            auto expected = lexer->tokenize(input);
+            lexer->setMode(LexerMode::TABLE);
+            auto actual = lexer->tokenize(input);
+
+            assert(expected.size() == actual.size());
+            for (size_t i = 0; i < expected.size(); i++) {
+                assert(expected[i].type == actual[i].type);
+                assert(expected[i].value == actual[i].value);
+            }
+        }
+    }
+};
+
+
+class TestTokenStream : public LexerTestCase {
+public:
+    void run() override {
+        std::string input = "total = price * 2.5 + \"tax\" @";
+        auto expected = lexer->tokenize(input);
+        auto stream = lexer->scan(input);
+
+        assert(stream.size() == expected.size());
+        for (size_t i = 0; i < stream.size(); i++) {
+            assert(stream[i].type == expected[i].type);
+            assert(stream[i].value == expected[i].value);
+        }
+
+        // Token values are views into the stream's own copy of the source
+        const std::string& source = stream.getSource();
+        assert(stream[0].value.data() == source.data());
+        assert(stream[2].value.data() == source.data() + 8);
+        assert(stream[7].type == TokenType::ERROR);
+        assert(stream[7].value == "Unknown character: @");
+
+        // The chain mode scans into tokens first, then lays them out as a stream
+        lexer->setMode(LexerMode::CHAIN);
+        auto chain = lexer->scan("1 + @");
+        lexer->setMode(LexerMode::TABLE);
+        assert(chain.size() == 4);
+        assert(chain[1].value == "+");
+        assert(chain[2].type == TokenType::ERROR);
+        assert(chain[2].value == "Unknown character: @");
+        assert(chain[3].type == TokenType::END);
+    }
+};
+
+
+class TestScanKernels : public LexerTestCase {
+public:
+    void run() override {
+        std::string ident(70, 'a'), digits(70, '7'), body(70, 'x');
+        ident[45] = '-'; digits[33] = 'x'; body[50] = '\'';
+        const std::vector<std::string> inputs = {
+            ident, digits, body, ident + "\x80", digits + "\xff", body + "\\n\"",
+            std::string(40, '_') + std::string(1, '\0') + "abc", "", "z", "a\"b'c"
+        };
+        const auto& scalar = ScanKernels::forLevel(SimdLevel::SCALAR);
+        const auto& best = ScanKernels::forLevel(ScanKernels::detect());
+        assert(best.level == ScanKernels::detect());
+
+        // Every start offset exercises both the vector body and the scalar tail
+        for (const auto& input : inputs) {
+            for (size_t pos = 0; pos <= input.size() + 1; pos++) {
+                assert(best.identifier(input, pos) == scalar.identifier(input, pos));
+                assert(best.digits(input, pos) == scalar.digits(input, pos));
+                assert(best.string(input, pos, '\'') == scalar.string(input, pos, '\''));
+                assert(best.string(input, pos, '\"') == scalar.string(input, pos, '\"'));
+            }
+        }
+    }
+};
+
+
+class TestStreamLexer : public LexerTestCase {
+public:
+    void run() override {
+        const std::vector<std::string> inputs = {
+            "total = (price >= 100) != 'long string literal' + 12.75",
+            "a<=b\nc==d\nname = \"x\\\"y\"", "1.2.3", "\"unterminated", "a ", "x = 1.", ""
+        };
+        // Tiny chunks force every kind of token across a boundary
+        for (const auto& input : inputs) {
+            auto expected = lexer->tokenize(input);
+            for (size_t chunk = 1; chunk <= 8; chunk++) {
+                std::istringstream in(input);
+                StreamLexer stream(in, chunk);
+                for (const auto& token : expected) {
+                    TokenView actual = stream.next();
+                    assert(actual.type == token.type);
+                    assert(actual.value == token.value);
+                }
+                assert(stream.next().type == TokenType::END);
+            }
+        }
+    }
+};
+
+
+class TestStreamLexerMemory : public LexerTestCase {
+public:
+    void run() override {
+        std::ostringstream script;
+        for (int i = 0; i < 20000; i++) script << "v" << i % 100 << " = " << i << " + 'ab'\n";
+        std::istringstream in(script.str());
+
+        StreamLexer stream(in, 64);
+        size_t count = 0;
+        for (TokenView token = stream.next(); token.type != TokenType::END; token = stream.next()) count++;
+
+        // The buffer never holds more than a chunk plus an unfinished token
+        assert(count == lexer->tokenize(script.str()).size() - 1);
+        assert(stream.bufferCapacity() <= 512);
+    }
+};
+
+
+class TestStreamLexerErrors : public LexerTestCase {
+public:
+    void run() override {
+        // A failed read is reported, not taken for the end of the input
+        size_t reads = 0;
+        StreamLexer failing([&reads](char* data, size_t size) -> size_t {
+            if (reads++ > 0) throw std::runtime_error("Cannot read input: I/O error");
+            std::string chunk = "x = 12 + long_identif";
+            size_t count = std::min(size, chunk.size());
+            chunk.copy(data, count);
+            return count;
+        }, 64);
+        for (const char* expected : {"x", "=", "12", "+"}) assert(failing.next().value == expected);
+        TokenView error = failing.next();
+        assert(error.type == TokenType::ERROR);
+        assert(error.value == "Cannot read input: I/O error");
+        assert(failing.next().type == TokenType::END);
+
+        // So is a stream whose buffer fails, and a descriptor that cannot be read
+        struct FailingBuffer : std::streambuf {
+            int_type underflow() override { throw std::runtime_error("Device lost"); }
+        } buffer;
+        std::istream in(&buffer);
+        StreamLexer stream(in, 16);
+        assert(stream.next().type == TokenType::ERROR);
+        StreamLexer closed(-1, 16);
+        TokenView unreadable = closed.next();
+        assert(unreadable.type == TokenType::ERROR);
+        assert(unreadable.value.find("Cannot read input") == 0);
+    }
+};
+
+
+class TestParallelScan : public LexerTestCase {
+public:
+    void run() override {
+        std::ostringstream script;
+        for (int i = 0; i < 300; i++) {
+            script << "v" << i << " = (v" << i / 2 << " + " << i << ".5) >= 'text " << i << "'\n";
+            // String literals spanning lines, and hence chunk boundaries
+            if (i % 7 == 0) script << "s" << i << " = \"multi\nline\n\" + x\n";
+        }
+        const std::vector<std::string> inputs = {
+            script.str(), script.str() + "bad = 1 @ 2\nmore = 3", script.str() + "x = 1 \ny = 2", "a\nb\nc",
+            "s = 'every\nsplit\nlands\ninside\nthis\nliteral\n' + 1\nt = 2"
+        };
+        for (const auto& input : inputs) {
+            auto expected = lexer->scan(input);
+            for (size_t threads = 2; threads <= 5; threads++) {
+                auto actual = lexer->scanParallel(input, threads, 16);
+                assert(actual.size() == expected.size());
+                for (size_t i = 0; i < expected.size(); i++) {
+                    assert(actual[i].type == expected[i].type);
+                    assert(actual[i].value == expected[i].value);
+                    assert(actual.getSpans()[i].offset == expected.getSpans()[i].offset);
+                }
+            }
+        }
+    }
+};
+
+
+class TestNumericLiterals : public LexerTestCase {
+public:
+    void run() override {
+        auto stream = lexer->scan("12 3.5 99999999999999999999 0.1234561 x");
+
+        assert(stream[0].hasLiteral);
+        assert(stream[0].literal.integer == 12);
+        assert(stream[1].hasLiteral);
+        assert(stream[1].literal.floating == 3.5);
+        assert(!stream[2].hasLiteral);      // Out of range, reported by the parser
+        assert(stream[3].literal.floating == 0.1234561);
+        // Identifiers carry their symbol instead
+        assert(stream[4].hasLiteral);
+        assert(SymbolTable::instance().name(stream[4].literal.symbol) == "x");
+    }
+};
+
+
+class TestSymbols : public LexerTestCase {
+public:
+    void run() override {
+        SymbolTable& symbols = SymbolTable::instance();
+        auto stream = lexer->scan("alpha + beta * alpha");
+        assert(stream[0].literal.symbol == stream[4].literal.symbol);
+        assert(stream[0].literal.symbol != stream[2].literal.symbol);
+        assert(symbols.intern("beta") == stream[2].literal.symbol);
+
+        // Every lexing path interns to the same ids
+        lexer->setMode(LexerMode::CHAIN);
+        auto chain = lexer->scan("beta");
+        lexer->setMode(LexerMode::TABLE);
+        assert(chain[0].literal.symbol == stream[2].literal.symbol);
+        std::istringstream input("alpha");
+        StreamLexer streamed(input);
+        assert(streamed.next().literal.symbol == stream[0].literal.symbol);
+
+        // Ids are dense and stable when many threads intern at once
+        size_t before = symbols.size();
+        std::vector<std::thread> workers;
+        std::vector<std::vector<uint32_t>> ids(4);
+        for (size_t t = 0; t < ids.size(); t++) {
+            workers.emplace_back([&ids, &symbols, t]() {
+                for (int i = 0; i < 1000; i++) ids[t].push_back(symbols.intern("sym_" + std::to_string(i)));
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        assert(symbols.size() == before + 1000);
+        for (size_t t = 1; t < ids.size(); t++) assert(ids[t] == ids[0]);
+        for (int i = 0; i < 1000; i++) {
+            assert(ids[0][i] < symbols.size());
+            assert(symbols.name(ids[0][i]) == "sym_" + std::to_string(i));
+        }
+    }
+};
+
+
 int main() {
     TestRunner runner;
     runner.addTest("Lexer: Operators", std::make_shared<TestOperators>());
@@ -136,6 +383,15 @@ int main() {
     runner.addTest("Lexer: Literals", std::make_shared<TestLiterals>());
     runner.addTest("Lexer: Errors", std::make_shared<TestErrors>());
     runner.addTest("Lexer: Empty Input", std::make_shared<TestEmptyInput>());
+    runner.addTest("Lexer: Table Matches Chain", std::make_shared<TestTableMatchesChain>());
+    runner.addTest("Lexer: Token Stream", std::make_shared<TestTokenStream>());
+    runner.addTest("Lexer: SIMD Kernels", std::make_shared<TestScanKernels>());
+    runner.addTest("Lexer: Stream Lexer", std::make_shared<TestStreamLexer>());
+    runner.addTest("Lexer: Stream Lexer Memory", std::make_shared<TestStreamLexerMemory>());
+    runner.addTest("Lexer: Stream Lexer Errors", std::make_shared<TestStreamLexerErrors>());
+    runner.addTest("Lexer: Parallel Scan", std::make_shared<TestParallelScan>());
+    runner.addTest("Lexer: Numeric Literals", std::make_shared<TestNumericLiterals>());
+    runner.addTest("Lexer: Symbols", std::make_shared<TestSymbols>());
     runner.runAll();
 
     return 0;
@@ -0,0 +1,309 @@
+/**
+ * @file tests/test_optimizer.cpp
+ * @brief Unit tests for the optimizer module.
+ **/
+
+#ifdef isTEST
+
+#include "test_framework.hpp"
+#include "ast.hpp"
+#include "parser.hpp"
+#include "interpreter.hpp"
+#include "optimizer.hpp"
+#include "flat.hpp"
+#include <random>
+
+using namespace DemoLang;
+using namespace DemoLang::AST;
+using namespace DemoLang::ParserSpace;
+using namespace DemoLang::InterpreterSpace;
+using namespace DemoLang::OptimizerSpace;
+
+
+class OptimizerTestCase : public TestCase {
+protected:
+    Optimizer* optimizer;
+    void setUp() override {
+        optimizer = &Optimizer::instance();
+        optimizer->setEnabled(true);
+        optimizer->resetStats();
+    }
+    void tearDown() override { optimizer = nullptr; }
+
+    std::shared_ptr<ASTNode> optimize(const std::string& source) {
+        return optimizer->optimize(Parser::instance().parseSource(source));
+    }
+};
+
+
+class TestConstantFolding : public OptimizerTestCase {
+public:
+    void run() override {
+        auto seven = std::dynamic_pointer_cast<IntNode>(optimize("1 + 2 * 3"));
+        assert(seven && seven->getValue() == 7);
+        assert(optimizer->stats().folded == 2);
+
+        auto half = std::dynamic_pointer_cast<FloatNode>(optimize("(2.5 * 2) / 10"));
+        assert(half && half->getValue() == 0.5L);
+        auto text = std::dynamic_pointer_cast<StringNode>(optimize("'con' + 'cat'"));
+        assert(text && text->getValue() == "concat");
+        auto negative = std::dynamic_pointer_cast<IntNode>(optimize("-(4 - 1)"));
+        assert(negative && negative->getValue() == -3);
+
+        // Exceptions fold into error nodes with the same message
+        auto division = std::dynamic_pointer_cast<ErrorNode>(optimize("1 / (2 - 2)"));
+        assert(division && division->getMessage() == "Division by zero");
+        auto type = std::dynamic_pointer_cast<ErrorNode>(optimize("'a' - 1"));
+        assert(type && type->getMessage() == "Type error");
+        auto operand = std::dynamic_pointer_cast<ErrorNode>(optimize("-'a'"));
+        assert(operand && operand->getMessage() == "Operand must be numeric");
+
+        // Only the constant part of a tree is folded, assignments stay
+        auto partial = optimize("total = price * (1 + 2)");
+        auto assign = dynamic_cast<BinaryOpNode*>(partial.get());
+        assert(assign && assign->getOp() == "=");
+        auto product = dynamic_cast<BinaryOpNode*>(assign->getRight());
+        assert(product && dynamic_cast<IdNode*>(product->getLeft()));
+        auto three = dynamic_cast<IntNode*>(product->getRight());
+        assert(three && three->getValue() == 3);
+
+        // Trees with nothing to fold are returned as they are, as is everything when disabled
+        auto plain = Parser::instance().parseSource("price * rate");
+        assert(optimizer->optimize(plain) == plain);
+        optimizer->setEnabled(false);
+        auto constant = Parser::instance().parseSource("1 + 2");
+        assert(optimizer->optimize(constant) == constant);
+    }
+};
+
+
+class TestIdentities : public OptimizerTestCase {
+public:
+    void run() override {
+        // Logical operators always give 0 or 1, so these identities hold
+        auto product = std::dynamic_pointer_cast<BinaryOpNode>(optimize("(a & b) * 1"));
+        assert(product && product->getOp() == "&");
+        auto sum = std::dynamic_pointer_cast<BinaryOpNode>(optimize("0 + (a | b)"));
+        assert(sum && sum->getOp() == "|");
+        auto negation = std::dynamic_pointer_cast<BinaryOpNode>(optimize("!(!(a < 1 | b))"));
+        assert(negation && negation->getOp() == "|");
+        auto minus = std::dynamic_pointer_cast<BinaryOpNode>(optimize("-(-(2.5 * (a & b)))"));
+        assert(minus && minus->getOp() == "*");
+        assert(optimizer->stats().simplified == 4);
+
+        // Side effects of the kept operand stay
+        auto assign = std::dynamic_pointer_cast<BinaryOpNode>(optimize("(y = 5) * 1"));
+        assert(assign && assign->getOp() == "=");
+
+        // A variable may hold a String or an Exception, so x * 1 is kept
+        auto variable = Parser::instance().parseSource("x * 1");
+        assert(optimizer->optimize(variable) == variable);
+        // x + 0 would turn a negative zero Float into a positive one
+        auto floating = std::dynamic_pointer_cast<BinaryOpNode>(optimize("(2.5 * (a & b)) + 0"));
+        assert(floating && floating->getOp() == "+");
+        // !(!x) is 0 or 1, not x
+        auto twice = std::dynamic_pointer_cast<UnaryOpNode>(optimize("!(!(2 * (a & b)))"));
+        assert(twice && twice->getOp() == "!");
+    }
+};
+
+
+class TestFlattening : public OptimizerTestCase {
+public:
+    void run() override {
+        // A left-deep chain of one operator becomes a single n-ary node
+        auto sum = std::dynamic_pointer_cast<NaryOpNode>(optimize("a + b + c + d"));
+        assert(sum && sum->getOp() == "+" && sum->size() == 4);
+        auto product = std::dynamic_pointer_cast<NaryOpNode>(optimize("a * b * c"));
+        assert(product && product->getOp() == "*" && product->size() == 3);
+        assert(optimizer->stats().flattened == 2);
+
+        // Other operators and operands of a different operator stay binary
+        auto mixed = std::dynamic_pointer_cast<NaryOpNode>(optimize("a * b + c * d + e"));
+        assert(mixed && mixed->size() == 3);
+        assert(std::dynamic_pointer_cast<BinaryOpNode>(mixed->getOperands()[0]));
+        assert(std::dynamic_pointer_cast<BinaryOpNode>(optimize("a - b - c")));
+        assert(std::dynamic_pointer_cast<BinaryOpNode>(optimize("a + (b + c)")));
+
+        // A long chain is as shallow as a short one
+        std::string source = "a";
+        for (int i = 0; i < 10000; i++) source += " + " + std::string(i % 2 ? "b" : "1");
+        auto chain = std::dynamic_pointer_cast<NaryOpNode>(optimize(source));
+        assert(chain && chain->size() == 10001);
+
+        // Constant chains fold, strings in a single join
+        auto joined = std::dynamic_pointer_cast<StringNode>(optimizer->optimize(std::make_shared<NaryOpNode>("+",
+            std::vector<std::shared_ptr<ASTNode>>{std::make_shared<StringNode>("a"), std::make_shared<StringNode>("b"),
+                                                  std::make_shared<StringNode>("c")})));
+        assert(joined && joined->getValue() == "abc");
+    }
+};
+
+
+class TestSameResults : public OptimizerTestCase {
+private:
+    std::mt19937 random{2024};
+
+    // Random tree over every node kind, biased towards identity operands
+    std::shared_ptr<ASTNode> randomTree(int depth) {
+        static const std::vector<std::string> binary = {"+", "-", "*", "/", "==", "!=", "<", "<=", ">", ">=", "&", "|", "%"};
+        static const std::vector<std::string> names = {"opt_a", "opt_b", "opt_c"};
+        switch (depth <= 0 ? random() % 6 : random() % 13) {
+            case 0: return std::make_shared<IntNode>(static_cast<long long>(random() % 5) - 2);
+            case 1: return std::make_shared<IntNode>(static_cast<long long>(random() % 2));
+            case 2: return std::make_shared<FloatNode>(random() % 3 ? (random() % 5) * 0.5L : -0.0L);
+            case 3: return std::make_shared<StringNode>(random() % 2 ? "x" : "");
+            case 4: return std::make_shared<IdNode>(names[random() % names.size()]);
+            case 5: return std::make_shared<ErrorNode>("Broken");
+            case 6:
+            case 7: {
+                auto operand = randomTree(depth - 1);
+                std::string op = random() % 5 ? (random() % 2 ? "-" : "!") : "~";
+                if (random() % 2) operand = std::make_shared<UnaryOpNode>(op, operand);
+                return std::make_shared<UnaryOpNode>(op, operand);
+            }
+            case 8: {
+                std::shared_ptr<ASTNode> target = std::make_shared<IdNode>(names[random() % names.size()]);
+                if (random() % 3 == 0) target = randomTree(depth - 1);
+                return std::make_shared<BinaryOpNode>("=", target, randomTree(depth - 1));
+            }
+            case 9: {
+                // Non-constant 0 or 1, which identities may rely on
+                auto boolean = std::make_shared<BinaryOpNode>(random() % 2 ? "&" : "|", randomTree(depth - 1), randomTree(depth - 1));
+                if (random() % 2) return boolean;
+                // Non-constant Float, possibly a negative zero
+                return std::make_shared<BinaryOpNode>("*", std::make_shared<FloatNode>(random() % 2 ? -0.0L : 1.5L), boolean);
+            }
+            case 10: return std::make_shared<BinaryOpNode>(random() % 2 ? "+" : "*", randomTree(depth - 1),
+                                                           std::make_shared<IntNode>(static_cast<long long>(random() % 2)));
+            default: return std::make_shared<BinaryOpNode>(binary[random() % binary.size()], randomTree(depth - 1), randomTree(depth - 1));
+        }
+    }
+
+    // Result of a tree and the variables it leaves behind
+    std::string evaluate(const std::shared_ptr<ASTNode>& tree, const std::vector<std::string>& start, bool flat) {
+        static const std::vector<std::string> names = {"opt_a", "opt_b", "opt_c"};
+        Interpreter& interpreter = Interpreter::instance();
+        for (size_t i = 0; i < names.size(); i++) interpreter.interpret(Parser::instance().parseSource(names[i] + " = " + start[i]));
+        std::string outcome = flat ? interpreter.interpret(FlatAST(*tree)) : interpreter.interpret(tree);
+        for (const std::string& name : names) outcome += "|" + interpreter.interpret(Parser::instance().parseSource(name));
+        return outcome;
+    }
+
+public:
+    void run() override {
+        static const std::vector<std::string> values = {"0", "1", "7", "-0.0", "2.5", "'s'", "''", "1 / 0"};
+        for (int i = 0; i < 5000; i++) {
+            auto tree = randomTree(5);
+            std::vector<std::string> start;
+            for (int j = 0; j < 3; j++) start.push_back(values[random() % values.size()]);
+
+            std::string expected = evaluate(tree, start, false);
+            auto optimized = optimizer->optimize(tree);
+            assert(evaluate(optimized, start, false) == expected);
+            assert(evaluate(optimized, start, true) == expected);
+        }
+        assert(optimizer->stats().folded > 0 && optimizer->stats().simplified > 0);
+
+        // Values where an unsound identity would show
+        static const std::vector<std::string> edges = {
+            "-0.0 * (opt_a | opt_b) + 0", "0 + -0.0 * (opt_a | opt_b)", "-0.0 * (opt_a | opt_b) - 0",
+            "(opt_a & opt_b) * 1", "opt_a * 1", "opt_a + 0", "!(!opt_a)", "-(-opt_a)",
+            "!(!(opt_a | opt_b))", "-(-(1.5 * (opt_a | opt_b)))", "opt_c = (opt_a = 2) * 1",
+            "(opt_a / 1) * 1", "1 / (opt_a & opt_b)", "'s' * 1 + opt_a",
+            "opt_a + opt_b + opt_c", "opt_a * opt_b * opt_c * 2", "opt_a + 1 + opt_b + 2.5 + opt_c",
+            "opt_a + opt_b * 1 + 0 + opt_c", "(opt_a + opt_b) * (opt_b + opt_c) * opt_a"
+        };
+        for (const std::string& edge : edges) {
+            for (size_t i = 0; i < values.size(); i++) {
+                std::vector<std::string> start = {values[i], values[(i + 1) % values.size()], values[(i + 3) % values.size()]};
+                auto tree = Parser::instance().parseSource(edge);
+                assert(evaluate(optimizer->optimize(tree), start, false) == evaluate(tree, start, false));
+            }
+        }
+    }
+};
+
+
+class TestDeadStatements : public OptimizerTestCase {
+private:
+    std::mt19937 random{20};
+
+    static std::vector<bool> live(const std::string& source) {
+        return Liveness().analyze(Parser::instance().parseProgram(source));
+    }
+
+    std::string randomExpression(int depth) {
+        static const std::vector<std::string> names = {"dead_a", "dead_b", "dead_c", "dead_d"};
+        static const std::vector<std::string> ops = {" + ", " - ", " * ", " / ", " < ", " & "};
+        switch (depth <= 0 ? random() % 3 : random() % 6) {
+            case 0: return std::to_string(random() % 5);
+            case 1:
+            case 2: return names[random() % names.size()];
+            case 3: return "(" + names[random() % names.size()] + " = " + randomExpression(depth - 1) + ")";
+            default: return "(" + randomExpression(depth - 1) + ops[random() % ops.size()] + randomExpression(depth - 1) + ")";
+        }
+    }
+
+    // Last result of a program, evaluated the way the file loader does
+    static std::string execute(const Program& program, const std::vector<bool>& keep) {
+        Interpreter& interpreter = Interpreter::instance();
+        for (const char* name : {"dead_a", "dead_b", "dead_c", "dead_d"}) {
+            interpreter.interpret(Parser::instance().parseSource(std::string(name) + " = 'unset'"));
+        }
+        FlatAST flat;
+        std::string last;
+        for (size_t i = 0; i < program.size(); i++) {
+            if (!keep[i]) continue;
+            size_t index = flat.statementCount();
+            flat.append(*Optimizer::instance().optimize(program[i].node));
+            last = interpreter.interpret(flat, index);
+        }
+        return last;
+    }
+
+public:
+    void run() override {
+        assert((live("a = 1\nb = 2\na + 1") == std::vector<bool>{true, false, true}));
+        // Overwritten before any read
+        assert((live("a = 1\na = 2\na") == std::vector<bool>{false, true, true}));
+        // Read by the statement that overwrites it
+        assert((live("a = 1\na = a + 1\na") == std::vector<bool>{true, true, true}));
+        assert((live("a = 1\nb = a + (a = 5)\nb") == std::vector<bool>{true, true, true}));
+        // Assignments nested in an expression count, an invalid target parses to an error
+        assert((live("1 + (a = 2)\n(b = 3) = 4\na * b") == std::vector<bool>{true, false, true}));
+        Program invalid;
+        invalid.add(std::make_shared<BinaryOpNode>("=", Parser::instance().parseSource("b = 3"), std::make_shared<IntNode>(4)), 1);
+        invalid.add(Parser::instance().parseSource("b"), 2);
+        assert((Liveness().analyze(invalid) == std::vector<bool>{true, true}));
+        // Pure expressions and errors before the last statement have no effect
+        assert((live("1 + 2\n1 + $\nc = 'x'\n7") == std::vector<bool>{false, false, false, true}));
+        // A chain of assignments stays live only as far as it is read
+        assert((live("a = 1\nb = a\nc = b\nd = 0\nc") == std::vector<bool>{true, true, true, false, true}));
+        assert(live("").empty());
+
+        // Skipping dead statements never changes the printed result
+        for (int i = 0; i < 2000; i++) {
+            std::string source;
+            for (int k = 0; k < 8; k++) source += randomExpression(3) + "\n";
+            Program program = Parser::instance().parseProgram(source);
+            std::vector<bool> keep = Liveness().analyze(program);
+            assert(execute(program, keep) == execute(program, std::vector<bool>(program.size(), true)));
+        }
+    }
+};
+
+
+int main() {
+    TestRunner runner;
+    runner.addTest("Optimizer: Constant Folding", std::make_shared<TestConstantFolding>());
+    runner.addTest("Optimizer: Identities", std::make_shared<TestIdentities>());
+    runner.addTest("Optimizer: Flattening", std::make_shared<TestFlattening>());
+    runner.addTest("Optimizer: Same Results", std::make_shared<TestSameResults>());
+    runner.addTest("Optimizer: Dead Statements", std::make_shared<TestDeadStatements>());
+    runner.runAll();
+
+    return 0;
+}
+
+#endif // isTEST
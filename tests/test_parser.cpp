@@ -8,13 +8,16 @@
 #include "test_framework.hpp"
 #include "tokens.hpp"
 #include "ast.hpp"
+#include "lexer.hpp"
 #include "parser.hpp"
+#include "flat.hpp"
 #include <memory>
 #include <vector>
 
 using namespace DemoLang;
 using namespace DemoLang::Tokens;
 using namespace DemoLang::AST;
+using namespace DemoLang::LexerSpace;
 using namespace DemoLang::ParserSpace;
 
 
@@ -163,6 +166,458 @@ public:
 
         auto errorNode = dynamic_cast<ErrorNode*>(ast.get());
         assert(errorNode);
+
+        // Lexer errors keep their message on the way through the token stream
+        std::vector<Token> lone = {
+            {TokenType::ERROR, "Unknown character: @"},
+            {TokenType::END, ""}
+        };
+        ast = parser->parse(lone);
+        errorNode = dynamic_cast<ErrorNode*>(ast.get());
+        assert(errorNode);
+        assert(errorNode->getMessage() == "Unknown character: @");
+
+        std::vector<Token> operand = {
+            {TokenType::INTEGER_LITERAL, "1"},
+            {TokenType::OPERATOR, "+"},
+            {TokenType::ERROR, "Unknown character: @"},
+            {TokenType::END, ""}
+        };
+        ast = parser->parse(operand);
+        auto plus = dynamic_cast<BinaryOpNode*>(ast.get());
+        assert(plus);
+        errorNode = dynamic_cast<ErrorNode*>(plus->getRight());
+        assert(errorNode);
+        assert(errorNode->getMessage() == "Unknown character: @");
+    }
+};
+
+
+class TestTokenStream : public ParserTestCase {
+public:
+    void run() override {
+        auto stream = Lexer::instance().scan("name = 'Demo' + (12 - 2.5)");
+        std::shared_ptr<ASTNode> ast = parser->parse(stream);
+        assert(ast);
+
+        auto assign = dynamic_cast<BinaryOpNode*>(ast.get());
+        assert(assign);
+        assert(assign->getOp() == "=");
+        assert(dynamic_cast<IdNode*>(assign->getLeft())->getName() == "name");
+
+        auto plus = dynamic_cast<BinaryOpNode*>(assign->getRight());
+        assert(plus);
+        assert(plus->getOp() == "+");
+        assert(dynamic_cast<StringNode*>(plus->getLeft())->getValue() == "Demo");
+
+        auto minus = dynamic_cast<BinaryOpNode*>(plus->getRight());
+        assert(minus);
+        assert(dynamic_cast<IntNode*>(minus->getLeft())->getValue() == 12);
+        assert(dynamic_cast<FloatNode*>(minus->getRight())->getValue() == 2.5);
+    }
+};
+
+
+// Renders a tree as an S-expression so two parses can be compared
+class TreePrinter : public ASTVisitor {
+public:
+    std::string text;
+
+    static std::string print(const std::shared_ptr<ASTNode>& node) {
+        TreePrinter printer;
+        node->accept(printer);
+        return printer.text;
+    }
+
+    void visit(UnaryOpNode& node) override {
+        text += "(" + node.getOp() + " ";
+        node.getOperand()->accept(*this);
+        text += ")";
+    }
+    void visit(BinaryOpNode& node) override {
+        text += "(" + node.getOp() + " ";
+        node.getLeft()->accept(*this);
+        text += " ";
+        node.getRight()->accept(*this);
+        text += ")";
+    }
+    void visit(NaryOpNode& node) override {
+        text += "(" + node.getOp();
+        for (size_t i = 0; i < node.size(); i++) {
+            text += " ";
+            node.getOperand(i)->accept(*this);
+        }
+        text += ")";
+    }
+    void visit(IdNode& node) override { text += node.getName(); }
+    void visit(IntNode& node) override { text += std::to_string(node.getValue()); }
+    void visit(FloatNode& node) override { text += std::to_string(node.getValue()); }
+    void visit(StringNode& node) override { text += "'" + node.getValue() + "'"; }
+    void visit(ErrorNode& node) override { text += "<error: " + node.getMessage() + ">"; }
+};
+
+
+class TestPullTokens : public ParserTestCase {
+private:
+    // Yields the tokens one by one, counting how many were pulled
+    static Generator<TokenView> counted(const std::vector<Token>& tokens, size_t& pulled) {
+        for (const auto& token : tokens) {
+            pulled++;
+            TokenView view{token.type, token.value};
+            view.hasLiteral = parseLiteral(view.type, view.value, view.literal);
+            co_yield view;
+        }
+    }
+
+public:
+    void run() override {
+        std::vector<std::string> sources = {
+            "name = 'Demo' + (12 - 2.5)", "-a * (b + 3) <= 4 & !c", "a = b = c", "--5",
+            "(1 + 2", "()", "1 + 2)", "x 1", "a  b", "5.5.5", "'open", "a + ", ""
+        };
+        for (const auto& source : sources) {
+            std::string expected = TreePrinter::print(parser->parse(Lexer::instance().scan(source)));
+            assert(TreePrinter::print(parser->parseSource(source)) == expected);
+        }
+
+        Lexer::instance().setMode(LexerMode::CHAIN);
+        assert(TreePrinter::print(parser->parseSource("1 + x * 2")) == "(+ 1 (* x 2))");
+        Lexer::instance().setMode(LexerMode::TABLE);
+
+        // Tokens after the expression are never pulled
+        std::vector<Token> tokens = {
+            {TokenType::IDENTIFIER, "a"}, {TokenType::OPERATOR, "+"}, {TokenType::IDENTIFIER, "b"},
+            {TokenType::IDENTIFIER, "c"}, {TokenType::IDENTIFIER, "d"}, {TokenType::END, ""}
+        };
+        size_t pulled = 0;
+        auto ast = parser->parse(counted(tokens, pulled));
+        assert(TreePrinter::print(ast) == "(+ a b)");
+        assert(pulled == 4);
+
+        // A generator that ends without END still terminates the parse
+        pulled = 0;
+        ast = parser->parse(counted({{TokenType::INTEGER_LITERAL, "7"}}, pulled));
+        assert(dynamic_cast<IntNode*>(ast.get()));
+    }
+};
+
+
+class TestPrecedence : public ParserTestCase {
+public:
+    void run() override {
+        // Operator ids follow the operators list
+        for (size_t i = 0; i < operators.size(); i++) assert(static_cast<size_t>(operatorOf(operators[i])) == i);
+        assert(operatorOf("=>") == Operator::NONE);
+
+        std::vector<std::pair<std::string, std::string>> cases = {
+            {"1 + 2 * 3 - 4", "(- (+ 1 (* 2 3)) 4)"},
+            {"a < b == c & d | e", "(| (& (== (< a b) c) d) e)"},
+            {"x = 1 + 2 < 3", "(= x (< (+ 1 2) 3))"},
+            {"a = b = c", "(= a b)"},
+            {"1 = 2", "<error: Left side of assignment must be an identifier>"},
+            {"-a * !b", "(* (- a) (! b))"},
+            {"--5", "(- <error: Unexpected operator: ->)"},
+            {"(1 + 2) * 3", "(* (+ 1 2) 3)"},
+            {"8 / 4 / 2", "(/ (/ 8 4) 2)"},
+            {"a = (b = 2)", "(= a (= b 2))"},
+            {"1 + 2 3", "(+ 1 2)"},
+        };
+        for (const auto& [source, expected] : cases) {
+            assert(TreePrinter::print(parser->parseSource(source)) == expected);
+        }
+
+        // Deep nesting parses without building anything per level
+        std::string deep = std::string(500, '(') + "7" + std::string(500, ')');
+        assert(TreePrinter::print(parser->parseSource(deep)) == "7");
+    }
+};
+
+
+class TestArenaTree : public ParserTestCase {
+public:
+    void run() override {
+        auto ast = parser->parseSource("total = (a + 1) * (b - 2.5) + 'x'");
+        std::string expected = "(= total (+ (* (+ a 1) (- b 2.500000)) 'x'))";
+        assert(TreePrinter::print(ast) == expected);
+
+        // Shared leaves stay alive with the tree even when the pools drop them
+        ASTFlyweight::clearCache();
+        for (int i = 0; i < 10000; i++) ASTFlyweight::getIntNode(100000 + i);
+        assert(TreePrinter::print(ast) == expected);
+
+        // The root is the only owner, copying it shares the whole tree
+        auto copy = ast;
+        ast.reset();
+        assert(TreePrinter::print(copy) == expected);
+
+        // Errors thrown while parsing still produce a standalone node
+        auto error = parser->parseSource("(");
+        assert(dynamic_cast<ErrorNode*>(error.get()));
+    }
+};
+
+
+class TestFlatTree : public ParserTestCase {
+public:
+    void run() override {
+        auto ast = parser->parseSource("y = -(x + 2) * 'a' <= 1.5");
+        FlatAST flat(*ast);
+        assert(flat.size() == 9);
+        assert(flat.getNodes()[flat.root()].op == OpCode::ASSIGN);
+        assert(sizeof(FlatNode) == 12);
+
+        // Children always precede their parents
+        for (uint32_t i = 0; i < flat.size(); i++) {
+            const FlatNode& node = flat.getNodes()[i];
+            if (node.op >= OpCode::ADD && node.op <= OpCode::OR) assert(node.a < i && node.b < i);
+        }
+
+        // The pointer tree stays available as a debugging view
+        assert(TreePrinter::print(flat.toTree()) == TreePrinter::print(ast));
+        std::string listing = flat.dump();
+        assert(listing.find("0: LOAD x\n") == 0);
+        assert(listing.find("8: ASSIGN y 7\n") != std::string::npos);
+    }
+};
+
+
+class TestStaticTypes : public ParserTestCase {
+private:
+    StaticType typeOf(const std::string& source) {
+        FlatAST flat(*parser->parseSource(source));
+        return flat.type(flat.root());
+    }
+
+public:
+    void run() override {
+        assert(typeOf("1 + 2 * 3") == StaticType::INTEGER);
+        assert(typeOf("1 + 2.5") == StaticType::FLOAT);
+        assert(typeOf("-(2.5)") == StaticType::FLOAT);
+        assert(typeOf("'a' + 'b'") == StaticType::STRING);
+        assert(typeOf("'a' == 'b'") == StaticType::INTEGER);
+        assert(typeOf("1 < 2.5") == StaticType::INTEGER);
+        assert(typeOf("'a' & x") == StaticType::INTEGER);
+        assert(typeOf("7 / 2") == StaticType::FLOAT);
+
+        // Anything that may fail or change type stays dynamic
+        assert(typeOf("x + 1") == StaticType::DYNAMIC);
+        assert(typeOf("1 / (2 - 2)") == StaticType::DYNAMIC);
+        assert(typeOf("1 / 0") == StaticType::DYNAMIC);
+        assert(typeOf("'a' + 1") == StaticType::DYNAMIC);
+        assert(typeOf("'a' < 'b'") == StaticType::DYNAMIC);
+        assert(typeOf("-'a'") == StaticType::DYNAMIC);
+        assert(typeOf("1 + $") == StaticType::DYNAMIC);
+
+        // A variable has the type last assigned to it in the same tree
+        FlatAST program;
+        program.append(*parser->parseSource("n = 4"));
+        program.append(*parser->parseSource("n * 2 + 1"));
+        assert(program.type(program.root()) == StaticType::INTEGER);
+        program.append(*parser->parseSource("n = n / 2"));
+        program.append(*parser->parseSource("n * 2"));
+        assert(program.type(program.root()) == StaticType::FLOAT);
+        program.append(*parser->parseSource("n = m"));
+        program.append(*parser->parseSource("n * 2"));
+        assert(program.type(program.root()) == StaticType::DYNAMIC);
+    }
+};
+
+
+class TestCommonSubexpressions : public ParserTestCase {
+public:
+    void run() override {
+        // Repeated pure subtrees become one node
+        FlatAST square(*parser->parseSource("(a * b + c) * (a * b + c)"));
+        assert(square.size() == 6);
+        assert(TreePrinter::print(square.toTree()) == "(* (+ (* a b) c) (+ (* a b) c))");
+
+        // Literals are keyed by their exact value
+        FlatAST close(*parser->parseSource("0.1234561 + 0.1234564 + 0.1234561"));
+        assert(close.size() == 4);
+
+        // A read after an assignment to the variable is a different value
+        FlatAST reassigned(*parser->parseSource("x + (x = 5) + x"));
+        assert(reassigned.size() == 6);
+
+        // Statements share subexpressions until a variable they read changes
+        FlatAST program;
+        program.append(*parser->parseSource("t = p * q + 1"));
+        size_t shared = program.size();
+        program.append(*parser->parseSource("u = p * q + 1"));
+        assert(program.size() == shared + 1);       // Only the assignment is new
+        program.append(*parser->parseSource("p = 2"));
+        size_t before = program.size();
+        program.append(*parser->parseSource("v = p * q + 1"));
+        assert(program.size() == before + 4);       // New p, product, sum and assignment
+        assert(program.statementCount() == 4);
+        assert(TreePrinter::print(program.toTree(1)) == "(= u (+ (* p q) 1))");
+    }
+};
+
+
+class TestProgram : public ParserTestCase {
+public:
+    void run() override {
+        Program program = parser->parseProgram(
+            "x = 1\n"
+            "\n"
+            "y = (x +\n"
+            "     2) * 3\n"
+            "  \t\n"
+            "f(1\n"
+            "\n"
+            "  + 2)\n"
+            "z = (1 + $\n"
+            "w = 4 ");
+        assert(program.size() == 5);
+        assert(program[0].line == 1);
+        assert(TreePrinter::print(program[0].node) == "(= x 1)");
+        // Whitespace at the line break does not end the statement
+        assert(program[1].line == 3);
+        assert(TreePrinter::print(program[1].node) == "(= y (* (+ x 2) 3))");
+        // Blank lines inside open parentheses are skipped
+        assert(program[2].line == 6);
+        assert(TreePrinter::print(program[2].node) == "f");
+        // A line that fails to lex is not continued
+        assert(program[3].line == 9);
+        assert(TreePrinter::print(program[3].node) == TreePrinter::print(parser->parseSource("z = (1 + $")));
+        assert(program[4].line == 10);
+        assert(TreePrinter::print(program[4].node) == "(= w 4)");
+
+        // Every statement parses as it would on its own line
+        for (const char* line : {"a = 1 + 2 * 3", "(1 + 2", "--5", "1 = 2", "a ", ""}) {
+            Program single = parser->parseProgram(line);
+            if (std::string(line).empty()) {
+                assert(single.empty());
+                continue;
+            }
+            assert(single.size() == 1);
+            assert(TreePrinter::print(single[0].node) == TreePrinter::print(parser->parseSource(line)));
+        }
+
+        // Parentheses still open at the end leave every line on its own
+        Program open = parser->parseProgram("(1 +\n2\n");
+        assert(open.size() == 2);
+        assert(TreePrinter::print(open[0].node) == "<error: Unexpected end of input, expected closing parenthesis>");
+        assert(open[1].line == 2);
+        assert(TreePrinter::print(open[1].node) == "2");
+    }
+};
+
+
+class TestUnclosedStatement : public ParserTestCase {
+public:
+    void run() override {
+        // One unclosed parenthesis does not take the rest of the script with it
+        Program program = parser->parseProgram("a = 1\nb = (a + 2\nc = 5\nd = c * 2\nd");
+        assert(program.size() == 5);
+        for (size_t i = 0; i < program.size(); i++) assert(program[i].line == i + 1);
+        assert(TreePrinter::print(program[1].node) == TreePrinter::print(parser->parseSource("b = (a + 2")));
+        assert(TreePrinter::print(program[2].node) == "(= c 5)");
+        assert(TreePrinter::print(program[3].node) == "(= d (* c 2))");
+        assert(TreePrinter::print(program[4].node) == "d");
+
+        // Lines that close the parentheses but do not parse together are not joined either
+        Program joined = parser->parseProgram("x = (1 +\n2 3)\ny = 4");
+        assert(joined.size() == 3);
+        assert(TreePrinter::print(joined[0].node) == TreePrinter::print(parser->parseSource("x = (1 +")));
+        assert(joined[1].line == 2);
+        assert(TreePrinter::print(joined[1].node) == TreePrinter::print(parser->parseSource("2 3)")));
+        assert(TreePrinter::print(joined[2].node) == "(= y 4)");
+
+        // A statement that does parse across lines is still joined
+        Program spanning = parser->parseProgram("x = (1 +\n2)\ny = 4");
+        assert(spanning.size() == 2);
+        assert(TreePrinter::print(spanning[0].node) == "(= x (+ 1 2))");
+        assert(spanning[1].line == 3);
+    }
+};
+
+
+class TestSourceCache : public ParserTestCase {
+public:
+    void run() override {
+        parser->clearCache();
+        parser->resetCacheStats();
+
+        // A repeated source is a hit and gets the same tree
+        auto first = parser->parseSource("total = price * (1 + rate)");
+        auto again = parser->parseSource("total = price * (1 + rate)");
+        assert(first == again);
+        assert(parser->cacheStats().hits == 1);
+        assert(parser->cacheStats().misses == 1);
+        // Only the exact text is a hit
+        auto spaced = parser->parseSource("total = price * (1 + rate) ");
+        assert(spaced != first);
+        assert(TreePrinter::print(spaced) == TreePrinter::print(first));
+        assert(parser->cacheStats().misses == 2);
+
+        // Lines of a program go through the same cache
+        Program program = parser->parseProgram("total = price * (1 + rate)\ntotal");
+        assert(program[0].node == first);
+        assert(parser->cacheStats().hits == 2);
+
+        // Clearing the flyweight pools leaves cached trees intact
+        ASTFlyweight::clearCache();
+        assert(parser->parseSource("total = price * (1 + rate)") == first);
+        assert(TreePrinter::print(first) == "(= total (* price (+ 1 rate)))");
+
+        // Evicted trees stay valid for whoever holds them
+        parser->configureCache(2, 0);
+        parser->parseSource("a");
+        parser->parseSource("b");
+        assert(parser->cacheSize() == 2);
+        assert(parser->cacheStats().evictions > 0);
+        assert(TreePrinter::print(first) == "(= total (* price (+ 1 rate)))");
+        assert(parser->parseSource("total = price * (1 + rate)") != first);
+
+        parser->configureCache(Parser::defaultCacheEntries, Parser::defaultCacheBytes);
+        parser->clearCache();
+        parser->resetCacheStats();
+    }
+};
+
+
+class TestDeepNesting : public ParserTestCase {
+public:
+    void run() override {
+        std::string deep = std::string(50000, '(') + "1" + std::string(50000, ')');
+        auto limited = dynamic_cast<ErrorNode*>(parser->parseSource(deep).get());
+        assert(limited && limited->getMessage() == "Maximum nesting depth exceeded");
+
+        // Nesting is bounded by the limit, not by the C++ stack
+        parser->setMaxDepth(100000);
+        auto one = dynamic_cast<IntNode*>(parser->parseSource(deep).get());
+        assert(one && one->getValue() == 1);
+        std::string negations;
+        for (int i = 0; i < 50000; i++) negations += "-(";
+        negations += "x" + std::string(50000, ')');
+        FlatAST chain(*parser->parseSource(negations));
+        assert(chain.size() == 50001);
+        assert(FlatAST(*chain.toTree()).size() == 50001);
+        parser->setMaxDepth(Parser::defaultMaxDepth);
+
+        // Errors inside deep groups still surface
+        auto unclosed = dynamic_cast<ErrorNode*>(parser->parseSource(std::string(5000, '(') + "1").get());
+        assert(unclosed && unclosed->getMessage() == "Unexpected end of input, expected closing parenthesis");
+    }
+};
+
+
+class TestNumericLiterals : public ParserTestCase {
+public:
+    void run() override {
+        auto overflow = parser->parse(Lexer::instance().scan("99999999999999999999"));
+        auto error = dynamic_cast<ErrorNode*>(overflow.get());
+        assert(error);
+        assert(error->getMessage() == "Invalid integer: 99999999999999999999");
+
+        // Literals differing past the sixth decimal are distinct nodes
+        auto first = parser->parse(Lexer::instance().scan("0.1234561"));
+        auto second = parser->parse(Lexer::instance().scan("0.1234564"));
+        assert(first != second);
+        assert(dynamic_cast<FloatNode*>(first.get())->getValue() == static_cast<long double>(0.1234561));
+        assert(dynamic_cast<FloatNode*>(second.get())->getValue() == static_cast<long double>(0.1234564));
     }
 };
 
@@ -173,6 +628,18 @@ int main() {
     runner.addTest("Parser: Binary Operator", std::make_shared<TestBinaryOp>());
     runner.addTest("Parser: Literals", std::make_shared<TestLiterals>());
     runner.addTest("Parser: Error Handling", std::make_shared<TestErrorHandling>());
+    runner.addTest("Parser: Token Stream", std::make_shared<TestTokenStream>());
+    runner.addTest("Parser: Numeric Literals", std::make_shared<TestNumericLiterals>());
+    runner.addTest("Parser: Pull Tokens", std::make_shared<TestPullTokens>());
+    runner.addTest("Parser: Precedence", std::make_shared<TestPrecedence>());
+    runner.addTest("Parser: Arena Tree", std::make_shared<TestArenaTree>());
+    runner.addTest("Parser: Flat Tree", std::make_shared<TestFlatTree>());
+    runner.addTest("Parser: Static Types", std::make_shared<TestStaticTypes>());
+    runner.addTest("Parser: Common Subexpressions", std::make_shared<TestCommonSubexpressions>());
+    runner.addTest("Parser: Program", std::make_shared<TestProgram>());
+    runner.addTest("Parser: Unclosed Statement", std::make_shared<TestUnclosedStatement>());
+    runner.addTest("Parser: Source Cache", std::make_shared<TestSourceCache>());
+    runner.addTest("Parser: Deep Nesting", std::make_shared<TestDeepNesting>());
     runner.runAll();
 
     return 0;
@@ -120,12 +120,134 @@ public:
 };
 
 
+class TestBoundedPoolLRU : public TestCase {
+public:
+    void run() override {
+        InternPool<int, std::string> pool;
+        pool.configure(2, 0, EvictionPolicy::LRU);
+        auto make = [](const std::string& v) { return [v]() { return std::make_shared<std::string>(v); }; };
+
+        auto one = pool.get(1, make("one"));
+        pool.get(2, make("two"));
+        pool.get(1, make("one"));       // 1 becomes most recent
+        pool.get(3, make("three"));     // evicts 2
+
+        assert(pool.size() == 2);
+        assert(pool.getStats().hits == 1);
+        assert(pool.getStats().misses == 3);
+        assert(pool.getStats().evictions == 1);
+        assert(pool.get(1, make("other")) == one);
+
+        // Evicted entries stay valid while referenced, the pool just forgets them
+        pool.configure(1, 0, EvictionPolicy::LRU);
+        auto three = pool.get(3, make("again"));
+        assert(*one == "one");
+        assert(*three == "again");
+        assert(pool.size() == 1);
+    }
+};
+
+
+class TestBoundedPoolClock : public TestCase {
+public:
+    void run() override {
+        InternPool<int, int> pool;
+        pool.configure(3, 0, EvictionPolicy::CLOCK);
+        auto make = [](int v) { return [v]() { return std::make_shared<int>(v); }; };
+
+        pool.get(1, make(1));
+        pool.get(2, make(2));
+        pool.get(3, make(3));
+        pool.get(1, make(1));   // 1 gets a second chance
+        pool.get(4, make(4));   // sweeps past 1 and evicts 2
+
+        assert(pool.size() == 3);
+        assert(pool.getStats().evictions == 1);
+        pool.resetStats();
+        pool.get(1, make(1));
+        pool.get(2, make(2));
+        assert(pool.getStats().hits == 1);
+        assert(pool.getStats().misses == 1);
+    }
+};
+
+
+class TestBoundedPoolBytes : public TestCase {
+public:
+    void run() override {
+        InternPool<std::string, int> pool;
+        pool.configure(0, 0, EvictionPolicy::LRU);
+        for (int i = 0; i < 100; i++) pool.get(std::string(100, 'a' + i % 26) + std::to_string(i), [i]() { return std::make_shared<int>(i); });
+        assert(pool.size() == 100);
+
+        // Shrinking the budget evicts until the estimate fits
+        size_t budget = pool.bytes() / 4;
+        pool.configure(0, budget, EvictionPolicy::LRU);
+        assert(pool.bytes() <= budget);
+        assert(pool.size() < 100 && pool.size() > 0);
+        assert(pool.getStats().evictions == 100 - pool.size());
+
+        // Objects holding more than their own size are weighed by the caller
+        InternPool<int, int> weighed;
+        weighed.configure(0, 10000, EvictionPolicy::LRU);
+        assert(!weighed.find(1));
+        weighed.insert(1, std::make_shared<int>(1), 6000);
+        weighed.insert(2, std::make_shared<int>(2), 6000);
+        assert(weighed.size() == 1 && !weighed.find(1) && weighed.find(2));
+        assert(weighed.getStats().misses == 2 && weighed.getStats().hits == 1);
+    }
+};
+
+
+class TestArena : public TestCase {
+public:
+    void run() override {
+        static int destroyed;
+        struct Tracked {
+            std::string name;
+            Tracked(std::string name) : name(std::move(name)) {}
+            ~Tracked() { destroyed++; }
+        };
+        struct alignas(32) Wide { char bytes[40]; };
+
+        destroyed = 0;
+        auto kept = std::make_shared<int>(5);
+        {
+            Arena arena(256);
+            Tracked* first = arena.create<Tracked>("first");
+            for (int i = 0; i < 100; i++) {
+                Wide* wide = arena.create<Wide>();
+                assert(reinterpret_cast<uintptr_t>(wide) % 32 == 0);
+            }
+            arena.create<Tracked>("second");
+            assert(first->name == "first");
+            assert(arena.blockCount() > 1);
+            assert(arena.objectCount() == 2);      // Trivial objects need no finalizer
+
+            // Requests larger than a block still fit
+            char* big = static_cast<char*>(arena.allocate(4096, 1));
+            big[4095] = 'x';
+
+            arena.retain(kept);
+            assert(kept.use_count() == 2);
+            assert(destroyed == 0);
+        }
+        assert(destroyed == 2);
+        assert(kept.use_count() == 1);
+    }
+};
+
+
 int main() {
     TestRunner runner;
     runner.addTest("Utils: Chain of Responsibility", std::make_shared<TestChain>());
     runner.addTest("Utils: Singleton", std::make_shared<TestSingleton>());
     runner.addTest("Utils: Factory", std::make_shared<TestFactory>());
     runner.addTest("Utils: Flyweight Factory", std::make_shared<TestFlyweightFactory>());
+    runner.addTest("Utils: Bounded Pool LRU", std::make_shared<TestBoundedPoolLRU>());
+    runner.addTest("Utils: Bounded Pool Clock", std::make_shared<TestBoundedPoolClock>());
+    runner.addTest("Utils: Bounded Pool Bytes", std::make_shared<TestBoundedPoolBytes>());
+    runner.addTest("Utils: Arena", std::make_shared<TestArena>());
     runner.runAll();
 
     return 0;
@@ -0,0 +1,403 @@
+/**
+ * @file tests/test_vm.cpp
+ * @brief Unit tests for the compiled engines: stack and register machines and closures.
+ **/
+
+#ifdef isTEST
+
+#include "test_framework.hpp"
+#include "ast.hpp"
+#include "closure.hpp"
+#include "flat.hpp"
+#include "interpreter.hpp"
+#include "parser.hpp"
+#include "regvm.hpp"
+#include "vm.hpp"
+#include <random>
+
+using namespace DemoLang;
+using namespace DemoLang::AST;
+using namespace DemoLang::ValueTypes;
+using namespace DemoLang::ParserSpace;
+using namespace DemoLang::InterpreterSpace;
+using namespace DemoLang::VMSpace;
+
+
+class VMTestCase : public TestCase {
+protected:
+    Interpreter* interpreter;
+    VM* vm;
+    RegisterVM* registers;
+    ClosureEngine* closures;
+    void setUp() override {
+        interpreter = &Interpreter::instance();
+        vm = &VM::instance();
+        registers = &RegisterVM::instance();
+        closures = &ClosureEngine::instance();
+    }
+    void tearDown() override {
+        interpreter = nullptr;
+        vm = nullptr;
+        registers = nullptr;
+        closures = nullptr;
+    }
+
+    static std::shared_ptr<ASTNode> id(const std::string& name) { return std::make_shared<IdNode>(name); }
+    static std::shared_ptr<ASTNode> num(long long value) { return std::make_shared<IntNode>(value); }
+    static std::shared_ptr<ASTNode> bin(const std::string& op, std::shared_ptr<ASTNode> l, std::shared_ptr<ASTNode> r) {
+        return std::make_shared<BinaryOpNode>(op, l, r);
+    }
+
+    // Every engine runs the tree, so their environments stay in step
+    std::string same(const std::shared_ptr<ASTNode>& tree) {
+        std::string expected = interpreter->interpret(tree);
+        assert(vm->interpret(tree) == expected);
+        assert(registers->interpret(tree) == expected);
+        assert(closures->interpret(tree) == expected);
+        return expected;
+    }
+};
+
+
+class TestSameResults : public VMTestCase {
+private:
+    std::mt19937 random{23};
+
+    // Random tree over every node kind, including operators nothing parses to
+    std::shared_ptr<ASTNode> randomTree(int depth) {
+        static const std::vector<std::string> binary = {"+", "-", "*", "/", "==", "!=", "<", "<=", ">", ">=", "&", "|", "%"};
+        static const std::vector<std::string> names = {"vm_a", "vm_b", "vm_unset"};
+        switch (depth <= 0 ? random() % 5 : random() % 10) {
+            case 0: return num(static_cast<long long>(random() % 7) - 2);
+            case 1: return std::make_shared<FloatNode>((random() % 9) * 0.5L - 1);
+            case 2: return std::make_shared<StringNode>(random() % 2 ? "x" : "");
+            case 3: return id(names[random() % 2]);
+            case 4: return std::make_shared<ErrorNode>("Broken");
+            case 5: return std::make_shared<UnaryOpNode>(random() % 3 ? (random() % 2 ? "-" : "!") : "~", randomTree(depth - 1));
+            case 6: return bin("=", random() % 4 ? id(names[random() % names.size()]) : randomTree(depth - 1), randomTree(depth - 1));
+            case 7: {
+                std::vector<std::shared_ptr<ASTNode>> operands;
+                for (size_t i = random() % 4 + 2; i > 0; i--) operands.push_back(randomTree(depth - 1));
+                return std::make_shared<NaryOpNode>(random() % 2 ? "+" : "*", std::move(operands));
+            }
+            default: return bin(binary[random() % binary.size()], randomTree(depth - 1), randomTree(depth - 1));
+        }
+    }
+
+public:
+    void run() override {
+        same(bin("=", id("vm_a"), num(3)));
+        same(bin("=", id("vm_b"), std::make_shared<FloatNode>(1.5)));
+        for (int i = 0; i < 5000; i++) same(randomTree(5));
+
+        // Parsed statements, reading variables before and after they change
+        Parser& parser = Parser::instance();
+        for (const char* source : {"vm_x = 4", "vm_x + (vm_x = vm_x * 2) + vm_x", "vm_s = \"ab\" + \"cd\"",
+                                   "vm_s == \"abcd\"", "-vm_s", "1 / 0", "vm_y", "1 = 2", "(3 + 4) * vm_x / 2"}) {
+            same(parser.parseSource(source));
+        }
+        assert(vm->interpret(parser.parseSource("vm_x")) == "8");
+        assert(registers->interpret(parser.parseSource("vm_x")) == "8");
+        assert(vm->interpret(nullptr) == "Null AST Node");
+        assert(registers->interpret(nullptr) == "Null AST Node");
+        assert(closures->interpret(nullptr) == "Null AST Node");
+    }
+};
+
+
+class TestConstants : public VMTestCase {
+public:
+    void run() override {
+        // Equal literals share a slot, values of different types or signs do not
+        std::vector<std::shared_ptr<ASTNode>> operands = {
+            num(1), num(1), std::make_shared<FloatNode>(1.0L), std::make_shared<FloatNode>(1.0L),
+            std::make_shared<FloatNode>(0.0L), std::make_shared<FloatNode>(-0.0L),
+            std::make_shared<StringNode>("1"), std::make_shared<ErrorNode>("1")
+        };
+        auto tree = std::make_shared<NaryOpNode>("+", operands);
+        Chunk chunk = Compiler().compile(*tree);
+        assert(chunk.getConstants().size() == 6);
+        assert(chunk.getStackSize() == operands.size());
+        assert(vm->interpret(chunk) == interpreter->interpret(tree));
+
+        RegisterProgram program = RegisterCompiler().compile(*tree);
+        assert(program.getConstants().size() == 6);
+        assert(registers->interpret(program) == interpreter->interpret(tree));
+
+        // An empty chunk has no result
+        assert(vm->interpret(Chunk()) == "Failed to interpret");
+        assert(registers->interpret(RegisterProgram()) == "Failed to interpret");
+        assert(closures->interpret(ClosureProgram()) == "Failed to interpret");
+    }
+};
+
+
+class TestDisassembler : public VMTestCase {
+public:
+    void run() override {
+        auto tree = bin("=", id("vm_d"), bin("+", num(1), bin("*", id("vm_e"), num(2))));
+        Chunk chunk = Compiler().compile(*tree);
+        std::string x = std::to_string(SymbolTable::instance().intern("vm_d"));
+        std::string y = std::to_string(SymbolTable::instance().intern("vm_e"));
+        assert(chunk.disassemble() ==
+            "0000 CONSTANT 0 ; 1\n"
+            "0005 LOAD " + y + " ; vm_e\n"
+            "0010 CONSTANT 1 ; 2\n"
+            "0015 MUL\n"
+            "0016 ADD\n"
+            "0017 STORE " + x + " ; vm_d\n"
+            "0022 RETURN\n");
+        assert(chunk.getStackSize() == 3);
+
+        // Operators without an instruction of their own carry their id
+        auto other = std::make_shared<UnaryOpNode>("~", std::make_shared<NaryOpNode>("*",
+            std::vector<std::shared_ptr<ASTNode>>{num(2), num(3), bin("=", num(1), num(2))}));
+        assert(Compiler().compile(*other).disassemble() ==
+            "0000 CONSTANT 0 ; 2\n"
+            "0005 CONSTANT 1 ; 3\n"
+            "0010 CONSTANT 2 ; 1\n"
+            "0015 CONSTANT 0 ; 2\n"
+            "0020 POP\n"
+            "0021 POP\n"
+            "0022 CONSTANT 3 ; Left side of assignment must be an identifier\n"
+            "0027 CHAIN " + std::to_string(static_cast<int>(Operator::MULTIPLY)) + " 3\n"
+            "0033 UNARY " + std::to_string(static_cast<int>(Operator::NONE)) + "\n"
+            "0035 RETURN\n");
+
+        // Literals are frame slots, only computed values take an instruction
+        RegisterProgram program = RegisterCompiler().compile(*tree);
+        assert(program.disassemble() ==
+            "k0 = 1\n"
+            "k1 = 2\n"
+            "0000 GET r0, vm_e\n"
+            "0001 MUL r0, r0, k1\n"
+            "0002 ADD r0, k0, r0\n"
+            "0003 SET vm_d, r0\n"
+            "0004 RETURN r0\n");
+        assert(program.size() < chunk.instructionCount());
+        assert(chunk.instructionCount() == 7);
+        assert(RegisterCompiler().compile(*other).disassemble() ==
+            "k0 = 2\n"
+            "k1 = 3\n"
+            "k2 = 1\n"
+            "k3 = Left side of assignment must be an identifier\n"
+            "0000 MOVE c0, k0\n"
+            "0001 MOVE c1, k1\n"
+            "0002 MOVE c2, k3\n"
+            "0003 CHAIN " + std::to_string(static_cast<int>(Operator::MULTIPLY)) + " r0, c0, 3\n"
+            "0004 UNARY " + std::to_string(static_cast<int>(Operator::NONE)) + " r0, r0\n"
+            "0005 RETURN r0\n");
+    }
+};
+
+
+class TestRegisterAllocation : public VMTestCase {
+public:
+    void run() override {
+        std::vector<std::shared_ptr<ASTNode>> names;
+        for (int i = 0; i < 100; i++) {
+            names.push_back(id("vm_r" + std::to_string(i)));
+            same(bin("=", names.back(), num(i)));
+        }
+
+        // A left-leaning sum of numbers only keeps the running total and the next operand
+        std::vector<std::shared_ptr<ASTNode>> products;
+        for (const auto& name : names) products.push_back(bin("*", name, num(2)));
+        auto left = std::make_shared<NaryOpNode>("+", products);
+        RegisterProgram program = RegisterCompiler().compile(*left);
+        assert(program.getRegisterCount() == 2);
+        assert(program.getChainCount() == 0);
+        assert(program.getFrameSize() == 3);
+        assert(same(left) == "9900");
+
+        // Operand kinds are checked once per chain, so a long one compiles in linear time
+        std::vector<std::shared_ptr<ASTNode>> negated(200000, std::make_shared<UnaryOpNode>("-", names[1]));
+        auto terms = std::make_shared<NaryOpNode>("+", negated);
+        program = RegisterCompiler().compile(*terms);
+        assert(program.getRegisterCount() == 2);
+        assert(program.getChainCount() == 0);
+        assert(same(terms) == "-200000");
+
+        // Variables may hold strings, so their sum is one CHAIN over side by side slots
+        auto sum = std::make_shared<NaryOpNode>("+", names);
+        program = RegisterCompiler().compile(*sum);
+        assert(program.getRegisterCount() == 1);
+        assert(program.getChainCount() == 100);
+        assert(program.getCode()[program.size() - 2].op == RegisterProgram::Op::CHAIN);
+        assert(same(sum) == "4950");
+
+        // A right-leaning one reads every variable before the first addition
+        std::shared_ptr<ASTNode> right = names.back();
+        for (size_t i = names.size() - 1; i-- > 0;) right = bin("+", names[i], right);
+        assert(RegisterCompiler().compile(*right).getRegisterCount() == 100);
+        assert(same(right) == "4950");
+
+        // Strings leave their registers when the run ends
+        same(bin("=", id("vm_text"), bin("+", std::make_shared<StringNode>("a"), std::make_shared<StringNode>("b"))));
+        assert(same(bin("+", id("vm_text"), id("vm_text"))) == "abab");
+
+        // Nested chains take the slots above their parent's
+        std::vector<std::shared_ptr<ASTNode>> texts(1000, id("vm_text"));
+        texts[500] = std::make_shared<NaryOpNode>("+", std::vector<std::shared_ptr<ASTNode>>{id("vm_text"), std::make_shared<StringNode>("c")});
+        auto joined = std::make_shared<NaryOpNode>("+", texts);
+        assert(RegisterCompiler().compile(*joined).getChainCount() == 1002);
+        assert(same(joined).size() == 2001);
+    }
+};
+
+
+class TestClosures : public VMTestCase {
+public:
+    void run() override {
+        // Compiled once, the program no longer needs the tree
+        ClosureProgram program;
+        {
+            auto tree = Parser::instance().parseSource("vm_total = vm_total + vm_step * 2 + 1");
+            program = ClosureCompiler().compile(*tree);
+        }
+        assert(program.size() == 8);
+        assert(program.getDepth() == 5);
+        same(bin("=", id("vm_total"), num(0)));
+        same(bin("=", id("vm_step"), num(3)));
+        for (int i = 0; i < 10; i++) closures->run(program);
+        assert(closures->interpret(id("vm_total")) == "70");
+
+        // Variables are read on every run, not when compiling
+        same(bin("=", id("vm_step"), std::make_shared<FloatNode>(0.5L)));
+        assert(closures->interpret(program) == "72.000000");
+        same(bin("=", id("vm_step"), std::make_shared<StringNode>("x")));
+        assert(closures->interpret(program) == "Type error");
+
+        // A moved program keeps its operands
+        ClosureProgram moved = std::move(program);
+        same(bin("=", id("vm_step"), num(1)));
+        assert(closures->interpret(moved) == "Type error");
+        same(bin("=", id("vm_total"), num(0)));
+        assert(closures->interpret(moved) == "3");
+
+        // Chains are combined at once, nested ones included, whether called or walked
+        std::vector<std::shared_ptr<ASTNode>> words;
+        for (int i = 0; i < 1000; i++) words.push_back(std::make_shared<StringNode>(i % 2 ? "b" : "a"));
+        words.push_back(std::make_shared<NaryOpNode>("+", std::vector<std::shared_ptr<ASTNode>>{id("vm_step"), id("vm_step")}));
+        auto joined = std::make_shared<NaryOpNode>("+", words);
+        same(bin("=", id("vm_step"), std::make_shared<StringNode>("c")));
+        assert(same(joined).size() == 1002);
+        ClosureCompiler limited;
+        limited.setMaxDepth(2);
+        interpreter->setMaxDepth(2);
+        assert(closures->interpret(limited.compile(*joined)) == interpreter->interpret(joined));
+        interpreter->setMaxDepth(Interpreter::defaultMaxDepth);
+        std::shared_ptr<ASTNode> nested = joined;
+        for (int i = 0; i < 5000; i++) {
+            nested = std::make_shared<NaryOpNode>("+", std::vector<std::shared_ptr<ASTNode>>{std::make_shared<StringNode>("d"), nested});
+        }
+        ClosureProgram walked = ClosureCompiler().compile(*nested);
+        assert(walked.getDepth() > ClosureEngine::recursionLimit);
+        assert(closures->interpret(walked) == std::string(5000, 'd') + same(joined));
+    }
+};
+
+
+class TestDeepTrees : public VMTestCase {
+public:
+    void run() override {
+        ASTArena arena;
+        auto sum = arena.make<IntNode>(0);
+        for (int i = 0; i < 100000; i++) sum = arena.make<BinaryOpNode>("+", sum, arena.make<IntNode>(1));
+        auto negated = arena.make<IntNode>(7);
+        for (int i = 0; i < 100001; i++) negated = arena.make<UnaryOpNode>("-", negated);
+        assert(vm->interpret(sum) == "100000");
+        assert(vm->interpret(negated) == "-7");
+        assert(registers->interpret(sum) == "100000");
+        assert(registers->interpret(negated) == "-7");
+        // Too deep to call recursively, the closures run from a work stack
+        ClosureProgram deep = ClosureCompiler().compile(*negated);
+        assert(deep.getDepth() == 100002 && deep.getDepth() > ClosureEngine::recursionLimit);
+        assert(closures->interpret(deep) == "-7");
+        assert(closures->interpret(sum) == "100000");
+        assert(RegisterCompiler().compile(*negated).getRegisterCount() == 1);
+
+        // Too deep a subtree fails where the interpreter does, after the assignment before it
+        Compiler compiler;
+        compiler.setMaxDepth(1000);
+        interpreter->setMaxDepth(1000);
+        auto tree = bin("+", bin("=", id("vm_deep"), num(5)), negated);
+        assert(interpreter->interpret(tree) == "Maximum evaluation depth exceeded");
+        assert(vm->interpret(compiler.compile(*tree)) == "Maximum evaluation depth exceeded");
+        RegisterCompiler registerCompiler;
+        registerCompiler.setMaxDepth(1000);
+        assert(registers->interpret(registerCompiler.compile(*tree)) == "Maximum evaluation depth exceeded");
+        ClosureCompiler closureCompiler;
+        closureCompiler.setMaxDepth(1000);
+        assert(closures->interpret(closureCompiler.compile(*tree)) == "Maximum evaluation depth exceeded");
+        interpreter->setMaxDepth(Interpreter::defaultMaxDepth);
+        assert(same(id("vm_deep")) == "5");
+        assert(vm->interpret(compiler.compile(*negated)) == "Maximum evaluation depth exceeded");
+        assert(vm->interpret(compiler.compile(*num(1))) == "1");
+        assert(registers->interpret(registerCompiler.compile(*negated)) == "Maximum evaluation depth exceeded");
+        assert(registers->interpret(registerCompiler.compile(*num(1))) == "1");
+        assert(closures->interpret(closureCompiler.compile(*negated)) == "Maximum evaluation depth exceeded");
+        assert(closures->interpret(closureCompiler.compile(*num(1))) == "1");
+    }
+};
+
+
+class TestDepthLimit : public VMTestCase {
+public:
+    void run() override {
+        ASTArena arena;
+        auto negated = arena.make<IntNode>(7);
+        for (int i = 0; i < 2000; i++) negated = arena.make<UnaryOpNode>("-", negated);
+        auto tree = bin("+", bin("=", id("vm_limited"), num(5)), negated);
+        const std::string exceeded = "Maximum evaluation depth exceeded";
+
+        // Every engine, flat trees included, fails at the same node after the same assignment
+        same(bin("=", id("vm_limited"), num(0)));
+        interpreter->setMaxDepth(1000);
+        assert(interpreter->interpret(FlatAST(*tree, 1000)) == exceeded);
+        assert(interpreter->interpret(id("vm_limited")) == "5");
+        assert(interpreter->interpret(tree) == exceeded);
+        Compiler compiler;
+        compiler.setMaxDepth(1000);
+        assert(vm->interpret(compiler.compile(*tree)) == exceeded);
+        RegisterCompiler registerCompiler;
+        registerCompiler.setMaxDepth(1000);
+        assert(registers->interpret(registerCompiler.compile(*tree)) == exceeded);
+        ClosureCompiler closureCompiler;
+        closureCompiler.setMaxDepth(1000);
+        assert(closures->interpret(closureCompiler.compile(*tree)) == exceeded);
+        interpreter->setMaxDepth(Interpreter::defaultMaxDepth);
+        assert(same(id("vm_limited")) == "5");
+
+        // Later statements of a shared flat tree still run, and the limit only applies from when it is set
+        FlatAST program;
+        program.setMaxDepth(1000);
+        program.append(*bin("=", id("vm_limited"), num(6)));
+        program.append(*negated);
+        program.append(*id("vm_limited"));
+        assert(interpreter->interpret(program, 0) == "6");
+        assert(interpreter->interpret(program, 1) == exceeded);
+        assert(interpreter->interpret(program, 2) == "6");
+        program.setMaxDepth(FlatAST::defaultMaxDepth);
+        program.append(*negated);
+        assert(interpreter->interpret(program, 3) == "7");
+        assert(interpreter->interpret(FlatAST(*negated)) == interpreter->interpret(negated));
+    }
+};
+
+
+int main() {
+    TestRunner runner;
+    runner.addTest("VM: Same Results", std::make_shared<TestSameResults>());
+    runner.addTest("VM: Constants", std::make_shared<TestConstants>());
+    runner.addTest("VM: Disassembler", std::make_shared<TestDisassembler>());
+    runner.addTest("VM: Register Allocation", std::make_shared<TestRegisterAllocation>());
+    runner.addTest("VM: Closures", std::make_shared<TestClosures>());
+    runner.addTest("VM: Deep Trees", std::make_shared<TestDeepTrees>());
+    runner.addTest("VM: Depth Limit", std::make_shared<TestDepthLimit>());
+    runner.runAll();
+
+    return 0;
+}
+
+#endif // isTEST